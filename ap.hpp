@@ -1,6 +1,7 @@
 #ifndef DEOHAYER_AP_AP_HPP
 #define DEOHAYER_AP_AP_HPP
 
+#include "divisor.hpp"
 #include "integer.hpp"
 
 template <unsigned long long _Bitwidth>
@@ -9,4 +10,23 @@ using ap_int = ap::library::integer<_Bitwidth, true>;
 template <unsigned long long _Bitwidth>
 using ap_uint = ap::library::integer<_Bitwidth, false>;
 
+template <unsigned long long _Bitwidth>
+using ap_int_divisor = ap::library::divisor<_Bitwidth, true>;
+
+template <unsigned long long _Bitwidth>
+using ap_uint_divisor = ap::library::divisor<_Bitwidth, false>;
+
+// Heap words come from std::pmr::memory_resource given to the constructor.
+#if (__cplusplus >= 201703L) && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+
+template <unsigned long long _Bitwidth>
+using ap_pmr_int = ap::library::integer<_Bitwidth, true, std::pmr::polymorphic_allocator<ap::library::word_t>>;
+
+template <unsigned long long _Bitwidth>
+using ap_pmr_uint = ap::library::integer<_Bitwidth, false, std::pmr::polymorphic_allocator<ap::library::word_t>>;
+#endif
+#endif
+
 #endif
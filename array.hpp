@@ -2,6 +2,8 @@
 #define DEOHAYER_AP_ARRAY_HPP
 
 #include "core.hpp"
+#include <cstddef>  // std::max_align_t, std::size_t
+#include <cstring>  // std::memcpy
 #include <memory>   // std::unique_ptr
 #include <stdlib.h> // malloc, realloc, free
 
@@ -10,27 +12,257 @@ namespace ap
 namespace library
 {
 
+#if (AP_ALLOCATOR == 1)
+
+static constexpr index_t array_pool_log2(index_t value)
+{
+    return (value <= 1) ? 0 : 1 + array_pool_log2(value / 2);
+}
+
+// Thread-local pool of arrays. Sizes are rounded up to a power of two bytes, freed arrays are kept in a list per size and
+// reused by the thread which freed them, so short-lived temporaries do not go through malloc. Arrays longer than
+// AP_POOL_MAX_SIZE bytes are not pooled. Each array is preceded by a header with its size.
+class array_pool
+{
+    enum : index_t
+    {
+        // Header keeps arrays aligned as malloc does.
+        header = alignof(std::max_align_t),
+        min_log = 4,
+        classes = array_pool_log2(AP_POOL_MAX_SIZE) - min_log + 1
+    };
+
+    static_assert(header >= 2 * sizeof(index_t), "AP: array_pool header must hold size and class");
+
+    // Trivially destructible, so the pool is still usable while thread-local objects are destroyed.
+    struct state
+    {
+        void* heads[classes];
+        index_t counts[classes];
+        bool closed;
+    };
+
+    // Frees the arrays kept by the thread, arrays freed later go to free().
+    struct flush
+    {
+        ~flush()
+        {
+            state& pool = array_pool::local();
+            for (index_t i = 0; i < classes; ++i)
+            {
+                while (pool.heads[i] != nullptr)
+                {
+                    void* ptr = pool.heads[i];
+                    pool.heads[i] = *static_cast<void**>(ptr);
+                    std::free(static_cast<char*>(ptr) - header);
+                }
+                pool.counts[i] = 0;
+            }
+            pool.closed = true;
+        }
+    };
+
+    static state& local()
+    {
+        static thread_local state pool;
+        return pool;
+    }
+
+    static index_t& size_of(void* ptr)
+    {
+        return reinterpret_cast<index_t*>(static_cast<char*>(ptr) - header)[0];
+    }
+
+    static index_t& class_of(void* ptr)
+    {
+        return reinterpret_cast<index_t*>(static_cast<char*>(ptr) - header)[1];
+    }
+
+public:
+    static void* allocate(index_t bytes)
+    {
+        index_t cls = classes;
+        if (bytes <= AP_POOL_MAX_SIZE)
+        {
+            cls = 0;
+            while ((index_t{1} << (cls + min_log)) < bytes)
+            {
+                ++cls;
+            }
+            state& pool = local();
+            void* ptr = pool.heads[cls];
+            if (ptr != nullptr)
+            {
+                pool.heads[cls] = *static_cast<void**>(ptr);
+                --pool.counts[cls];
+                return ptr;
+            }
+            bytes = index_t{1} << (cls + min_log);
+        }
+        char* base = static_cast<char*>(std::malloc(header + bytes));
+        if (base == nullptr)
+        {
+            return nullptr;
+        }
+        void* ptr = base + header;
+        size_of(ptr) = bytes;
+        class_of(ptr) = cls;
+        return ptr;
+    }
+
+    static void deallocate(void* ptr)
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+        const index_t cls = class_of(ptr);
+        state& pool = local();
+        if ((cls == classes) || pool.closed || (pool.counts[cls] >= AP_POOL_DEPTH))
+        {
+            std::free(static_cast<char*>(ptr) - header);
+            return;
+        }
+        static thread_local flush guard;
+        AP_UNUSED(guard);
+        *static_cast<void**>(ptr) = pool.heads[cls];
+        pool.heads[cls] = ptr;
+        ++pool.counts[cls];
+    }
+
+    static void* reallocate(void* ptr, index_t bytes)
+    {
+        if (ptr == nullptr)
+        {
+            return allocate(bytes);
+        }
+        const index_t size = size_of(ptr);
+        if ((class_of(ptr) != classes) && (bytes <= size))
+        {
+            return ptr;
+        }
+        if ((class_of(ptr) == classes) && (bytes > AP_POOL_MAX_SIZE))
+        {
+            char* base = static_cast<char*>(std::realloc(static_cast<char*>(ptr) - header, header + bytes));
+            if (base == nullptr)
+            {
+                return nullptr;
+            }
+            ptr = base + header;
+            size_of(ptr) = bytes;
+            return ptr;
+        }
+        void* result = allocate(bytes);
+        if (result != nullptr)
+        {
+            std::memcpy(result, ptr, AP_MIN(size, bytes));
+            deallocate(ptr);
+        }
+        return result;
+    }
+};
+
+static inline void array_free(void* ptr)
+{
+    array_pool::deallocate(ptr);
+}
+
+#else
+
+static inline void array_free(void* ptr)
+{
+    std::free(ptr);
+}
+
+#endif
+
+// Stateless deleter, so array is as large as a pointer and frees its words with a direct call.
+struct array_deleter
+{
+    void operator()(void* ptr) const
+    {
+        array_free(ptr);
+    }
+};
+
 template <typename T>
-using array = std::unique_ptr<T[], void (*)(void*)>;
+using array = std::unique_ptr<T[], array_deleter>;
 
 template <typename T>
 array<T> array_alloc(index_t count)
 {
-    return array<T>{reinterpret_cast<T*>(std::malloc(sizeof(T) * count)), &std::free};
+#if (AP_ALLOCATOR == 1)
+    return array<T>{reinterpret_cast<T*>(array_pool::allocate(sizeof(T) * count))};
+#else
+    return array<T>{reinterpret_cast<T*>(std::malloc(sizeof(T) * count))};
+#endif
 }
 
 template <typename T>
 array<T>& array_realloc(array<T>& arr, index_t count)
 {
     T* raw_ptr = arr.release();
+#if (AP_ALLOCATOR == 1)
+    arr.reset(reinterpret_cast<T*>(array_pool::reallocate(raw_ptr, sizeof(T) * count)));
+#else
     arr.reset(reinterpret_cast<T*>(std::realloc(raw_ptr, sizeof(T) * count)));
+#endif
     return arr;
 }
 
 template <typename T>
 array<T> array_null()
 {
-    return array<T>{reinterpret_cast<T*>(NULL), &std::free};
+    return array<T>{reinterpret_cast<T*>(NULL)};
+}
+
+// Allocator with the interface of std::allocator, arrays come from the same place as those of array_alloc. Default
+// allocator of integer storage.
+template <typename T>
+struct array_allocator
+{
+    using value_type = T;
+
+    array_allocator() = default;
+
+    template <typename U>
+    array_allocator(const array_allocator<U>& other)
+    {
+        AP_UNUSED(other);
+    }
+
+    T* allocate(std::size_t count)
+    {
+        return array_alloc<T>(count).release();
+    }
+
+    void deallocate(T* ptr, std::size_t count)
+    {
+        AP_UNUSED(count);
+        array_free(ptr);
+    }
+
+    // Words keep their values up to the lesser of size and count.
+    T* reallocate(T* ptr, std::size_t size, std::size_t count)
+    {
+        AP_UNUSED(size);
+        array<T> arr{ptr};
+        return array_realloc(arr, count).release();
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const array_allocator<T>& left, const array_allocator<U>& right)
+{
+    AP_UNUSED(left);
+    AP_UNUSED(right);
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const array_allocator<T>& left, const array_allocator<U>& right)
+{
+    return !(left == right);
 }
 
 } // namespace library
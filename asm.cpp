@@ -4,6 +4,8 @@
 #if (DEOHAYER_AP_ASM_CPP == 1) == defined(AP_USE_SOURCES)
 
 #include "asm.hpp"
+#include <cstdint>
+#include <utility>
 
 namespace ap
 {
@@ -183,135 +185,2136 @@ dword_t asm_mul(const rregister& left, const rregister& right, wregister& out)
     return carry;
 }
 
+// Full square of in, written to out[0, 2 * in.size).
+// Cross products are computed once and doubled, squares of words are added on the diagonal.
+static void sqr_basecase(const rregister& in, word_t* out)
+{
+    const index_t n = in.size;
+    wregister result{out, index_t(2 * n), 0, false};
+    asm_fill(result, 0);
+    for (index_t i = 0; i + 1 < n; ++i)
+    {
+        const index_t size = n - i - 1;
+        wregister row{out + 2 * i + 1, index_t(size + 1), size, false};
+        asm_mul_short(rregister{in.words + i + 1, size, size, false}, in.words[i], row);
+    }
+    if (n > 1)
+    {
+        asm_lsh(rregister(result), 1, result);
+    }
+    dword_t carry = 0;
+    for (index_t i = 0; i < n; ++i)
+    {
+        const dword_t square = dword_t{in.words[i]} * in.words[i];
+        carry += out[2 * i];
+        carry += static_cast<word_t>(square);
+        out[2 * i] = static_cast<word_t>(carry);
+        carry >>= word_traits::bits;
+        carry += out[2 * i + 1];
+        carry += (square >> word_traits::bits);
+        out[2 * i + 1] = static_cast<word_t>(carry);
+        carry >>= word_traits::bits;
+    }
+}
+
+// Write |left - right| to out, left.size words.
+// Return: true if left is arithmetically less than right.
+// Preconditions:
+// right.size in [0, left.size].
+// out.capacity >= left.size.
+static inline bool asm_diff(const rregister& left, const rregister& right, wregister& out)
+{
+    rregister lhigh{left.words + right.size, index_t(left.size - right.size), index_t(left.size - right.size), false};
+    rregister llow{left.words, right.size, right.size, false};
+    if ((asm_trim(lhigh.words, lhigh.size) != 0) || (asm_cmp(llow, right).result != cmpres::less))
+    {
+        asm_sub(left, right, out);
+        return false;
+    }
+    asm_sub(right, llow, out);
+    wregister ohigh{out.words + right.size, lhigh.size, 0, false};
+    asm_fill(ohigh, 0);
+    out.size = left.size;
+    return true;
+}
+
+// Scratch words required by karatsuba_mul for operands of at most size words.
+static inline index_t karatsuba_scratch(index_t size)
+{
+    index_t scratch = 0;
+    while (size >= AP_KARATSUBA_THRESHOLD)
+    {
+        size = (size + 1) / 2;
+        scratch += 4 * size + 2;
+    }
+    return scratch;
+}
+
+static void karatsuba_sqr(const rregister& in, word_t* out, word_t* scratch);
+
+// Full product of left and right, written to out[0, left.size + right.size).
+// Preconditions:
+// right.size in [1, left.size].
+// scratch holds at least karatsuba_scratch(left.size) words.
+static void karatsuba_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch)
+{
+    if ((left.words == right.words) && (left.size == right.size))
+    {
+        karatsuba_sqr(left, out, scratch);
+        return;
+    }
+    const index_t n = left.size;
+    const index_t m = right.size;
+    wregister r{out, index_t(n + m), 0, false};
+    if (m < AP_KARATSUBA_THRESHOLD)
+    {
+        asm_mul(left, right, r);
+        return;
+    }
+
+    const index_t k = (n + 1) / 2;
+    if (m <= k)
+    {
+        // Unbalanced operands, multiply right by m-word chunks of left.
+        rregister chunk{left.words, m, m, false};
+        karatsuba_mul(chunk, right, out, scratch);
+        word_t* tmp = scratch;
+        for (index_t offset = m; offset < n; offset += m)
+        {
+            chunk.words = left.words + offset;
+            chunk.size = AP_MIN(m, n - offset);
+            karatsuba_mul(right, chunk, tmp, scratch + 2 * m);
+            // out[offset, offset + m) already holds the upper part of the previous chunk.
+            std::memcpy(out + offset + m, tmp + m, chunk.size * word_traits::bytes);
+            index_t size = m + chunk.size;
+            wregister acc{out + offset, size, size, false};
+            asm_add(rregister(acc), rregister{tmp, m, m, false}, acc);
+        }
+        return;
+    }
+
+    // left = a1 * base^k + a0, right = b1 * base^k + b0.
+    const rregister a0{left.words, k, k, false};
+    const rregister a1{left.words + k, index_t(n - k), index_t(n - k), false};
+    const rregister b0{right.words, k, k, false};
+    const rregister b1{right.words + k, index_t(m - k), index_t(m - k), false};
+
+    // z0 = a0 * b0 and z2 = a1 * b1 are written in place.
+    karatsuba_mul(a0, b0, out, scratch);
+    karatsuba_mul(a1, b1, out + 2 * k, scratch);
+
+    // zm = |a0 - a1| * |b0 - b1|.
+    wregister da{scratch, k, 0, false};
+    wregister db{scratch + k, k, 0, false};
+    const bool negative = asm_diff(a0, a1, da) != asm_diff(b0, b1, db);
+    word_t* zm_words = scratch + 2 * k + 1;
+    karatsuba_mul(rregister(da), rregister(db), zm_words, zm_words + 2 * k + 1);
+    const rregister zm{zm_words, index_t(2 * k), index_t(2 * k), false};
+
+    // z1 = z0 + z2 - (a0 - a1) * (b0 - b1), reuses the words of da and db.
+    const index_t z2_size = n + m - 2 * k;
+    wregister z1{scratch, index_t(2 * k + 1), 0, false};
+    asm_add(rregister{out, index_t(2 * k), index_t(2 * k), false}, rregister{out + 2 * k, z2_size, z2_size, false}, z1);
+    if (negative)
+    {
+        z1.capacity = z1.size;
+        asm_add(rregister(z1), zm, z1);
+    }
+    else
+    {
+        asm_sub(rregister(z1), zm, z1);
+    }
+    asm_trim(z1);
+
+    // out += z1 * base^k.
+    index_t size = n + m - k;
+    wregister acc{out + k, size, size, false};
+    asm_add(rregister(acc), rregister(z1), acc);
+}
+
+// Full square of in, written to out[0, 2 * in.size). Karatsuba with (a0 - a1)^2, which is never negative.
+// Preconditions:
+// scratch holds at least karatsuba_scratch(in.size) words.
+static void karatsuba_sqr(const rregister& in, word_t* out, word_t* scratch)
+{
+    const index_t n = in.size;
+    if (n < AP_KARATSUBA_THRESHOLD)
+    {
+        sqr_basecase(in, out);
+        return;
+    }
+
+    // in = a1 * base^k + a0.
+    const index_t k = (n + 1) / 2;
+    const rregister a0{in.words, k, k, false};
+    const rregister a1{in.words + k, index_t(n - k), index_t(n - k), false};
+
+    // z0 = a0^2 and z2 = a1^2 are written in place.
+    karatsuba_sqr(a0, out, scratch);
+    karatsuba_sqr(a1, out + 2 * k, scratch);
+
+    // zm = (a0 - a1)^2.
+    wregister da{scratch, k, 0, false};
+    asm_diff(a0, a1, da);
+    word_t* zm_words = scratch + 2 * k + 1;
+    karatsuba_sqr(rregister(da), zm_words, zm_words + 2 * k + 1);
+    const rregister zm{zm_words, index_t(2 * k), index_t(2 * k), false};
+
+    // z1 = z0 + z2 - zm, reuses the words of da.
+    const index_t z2_size = 2 * (n - k);
+    wregister z1{scratch, index_t(2 * k + 1), 0, false};
+    asm_add(rregister{out, index_t(2 * k), index_t(2 * k), false}, rregister{out + 2 * k, z2_size, z2_size, false}, z1);
+    asm_sub(rregister(z1), zm, z1);
+    asm_trim(z1);
+
+    // out += z1 * base^k.
+    index_t size = 2 * n - k;
+    wregister acc{out + k, size, size, false};
+    asm_add(rregister(acc), rregister(z1), acc);
+}
+
+// Full product kernel, writes left.size + right.size words to out and uses scratch for temporaries.
+using mul_kernel_t = void (*)(const rregister&, const rregister&, word_t*, word_t*);
+
+// Full square kernel, writes 2 * in.size words to out and uses scratch for temporaries.
+using sqr_kernel_t = void (*)(const rregister&, word_t*, word_t*);
+
+// Square kernel in the form of a product kernel, right is the same register as left.
+template <sqr_kernel_t kernel>
+static void sqr_as_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch)
+{
+    AP_UNUSED(right);
+    kernel(left, out, scratch);
+}
+
+static void sqr_basecase_kernel(const rregister& in, word_t* out, word_t* scratch)
+{
+    AP_UNUSED(scratch);
+    sqr_basecase(in, out);
+}
+
+// Run a full product kernel and wrap its result to out.capacity.
+// Scratch for the whole product is allocated once, unless it is given, scratch_size is what the kernel requires for these
+// operands.
+// Product is written to scratch first when it is truncated or when out refers to the words of an operand.
+template <mul_kernel_t kernel>
+dword_t asm_mul_wrapped(const rregister& left, const rregister& right, wregister& out, index_t scratch_size, word_t* scratch)
+{
+    const index_t size = left.size + right.size;
+    const bool copy = (size > out.capacity) || (out.words == left.words) || (out.words == right.words);
+    const index_t total = scratch_size + (copy ? size : 0);
+    auto buffer = array_null<word_t>();
+    if ((scratch == nullptr) && (total != 0))
+    {
+        buffer = array_alloc<word_t>(total);
+        scratch = buffer.get();
+    }
+    word_t* product = (copy ? scratch + scratch_size : out.words);
+    kernel(left, right, product, scratch);
+    dword_t carry = 0;
+    out.size = AP_MIN(size, out.capacity);
+    if (copy)
+    {
+        std::memcpy(out.words, product, out.size * word_traits::bytes);
+        carry = (asm_trim(product + out.size, size - out.size) != 0);
+    }
+    return carry;
+}
+
+index_t asm_mul_karatsuba_scratch(index_t left_size, index_t right_size)
+{
+    return karatsuba_scratch(left_size) + left_size + right_size;
+}
+
+dword_t asm_mul_karatsuba(const rregister& left, const rregister& right, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<karatsuba_mul>(left, right, out, karatsuba_scratch(left.size), scratch);
+}
+
+index_t asm_sqr_scratch(index_t in_size)
+{
+    return 2 * in_size;
+}
+
+dword_t asm_sqr(const rregister& in, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<sqr_as_mul<sqr_basecase_kernel>>(in, in, out, 0, scratch);
+}
+
+index_t asm_sqr_karatsuba_scratch(index_t in_size)
+{
+    return karatsuba_scratch(in_size) + 2 * in_size;
+}
+
+dword_t asm_sqr_karatsuba(const rregister& in, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<sqr_as_mul<karatsuba_sqr>>(in, in, out, karatsuba_scratch(in.size), scratch);
+}
+
+// Toom-Cook helpers. Values are trimmed and carry their sign in the register.
+// Output capacity must be large enough to hold the result and a carry word.
+
+static inline bool toom_less(const rregister& left, const rregister& right)
+{
+    if (left.size != right.size)
+    {
+        return left.size < right.size;
+    }
+    return asm_cmp(left, right).result == cmpres::less;
+}
+
+static inline void toom_add(rregister left, rregister right, wregister& out)
+{
+    if (toom_less(left, right))
+    {
+        std::swap(left, right);
+    }
+    if (left.sign == right.sign)
+    {
+        asm_add(left, right, out);
+    }
+    else
+    {
+        asm_sub(left, right, out);
+    }
+    out.sign = left.sign;
+    asm_trim(out);
+    if (out.size == 0)
+    {
+        out.sign = 0;
+    }
+}
+
+static inline void toom_sub(const rregister& left, rregister right, wregister& out)
+{
+    right.sign = !right.sign;
+    toom_add(left, right, out);
+}
+
+static inline void toom_lsh(const rregister& in, index_t shift, wregister& out)
+{
+    out.size = 0;
+    if (in.size != 0)
+    {
+        asm_lsh(in, shift, out);
+        asm_trim(out);
+    }
+    out.sign = in.sign;
+}
+
+static inline void toom_rsh(const rregister& in, index_t shift, wregister& out)
+{
+    out.size = 0;
+    if (in.size != 0)
+    {
+        asm_rsh(in, shift, out);
+        asm_trim(out);
+    }
+    out.sign = (out.size != 0) && in.sign;
+}
+
+static inline void toom_divexact(const rregister& in, word_t divisor, wregister& out)
+{
+    asm_divexact_short(in, divisor, out);
+    asm_trim(out);
+    out.sign = (out.size != 0) && in.sign;
+}
+
+// out[0, size) += in, carry is propagated up to size.
+static inline void toom_add_at(word_t* out, index_t size, const rregister& in)
+{
+    wregister acc{out, in.size, in.size, false};
+    dword_t carry = asm_add(rregister(acc), in, acc);
+    for (index_t i = in.size; (carry != 0) && (i < size); ++i)
+    {
+        carry += out[i];
+        out[i] = static_cast<word_t>(carry);
+        carry >>= word_traits::bits;
+    }
+}
+
+// Evaluation points, in the order in which Toom-Cook variants use them.
+enum toom_point
+{
+    toom_zero,
+    toom_infinity,
+    toom_one,
+    toom_minus_one,
+    toom_two,
+    toom_minus_two,
+    toom_half,
+    toom_points
+};
+
+// Evaluate polynomial with count coefficients (k-word pieces of in) at the first points of toom_point.
+// Evaluation at 1/2 is scaled by 2^(count - 1) to remain integer.
+// Each of values and tmp holds k + 2 words.
+static void toom_eval(const rregister& in, index_t count, index_t k, index_t points, wregister* values, wregister* tmp)
+{
+    rregister pieces[4];
+    for (index_t i = 0; i < count; ++i)
+    {
+        pieces[i].words = in.words + i * k;
+        pieces[i].size = asm_trim(pieces[i].words, AP_MIN(k, in.size - i * k));
+    }
+    asm_cp(pieces[0], values[toom_zero]);
+    asm_cp(pieces[count - 1], values[toom_infinity]);
+
+    // Sums of even and odd pieces give values at 1 and -1.
+    wregister& even = tmp[0];
+    wregister& odd = tmp[1];
+    asm_cp(pieces[0], even);
+    asm_cp(pieces[1], odd);
+    for (index_t i = 2; i < count; ++i)
+    {
+        wregister& sum = ((i % 2) ? odd : even);
+        toom_add(rregister(sum), pieces[i], sum);
+    }
+    toom_add(rregister(even), rregister(odd), values[toom_one]);
+    toom_sub(rregister(even), rregister(odd), values[toom_minus_one]);
+    if (points == 4)
+    {
+        return;
+    }
+
+    // Sums of even and odd pieces, multiplied by powers of 2, give values at 2 and -2.
+    asm_cp(pieces[count - 1 - (count % 2 == 0)], even);
+    for (index_t i = count - 1 - (count % 2 == 0); i >= 2; i -= 2)
+    {
+        toom_lsh(rregister(even), 2, even);
+        toom_add(rregister(even), pieces[i - 2], even);
+    }
+    asm_cp(pieces[count - 1 - (count % 2 != 0)], odd);
+    for (index_t i = count - 1 - (count % 2 != 0); i >= 3; i -= 2)
+    {
+        toom_lsh(rregister(odd), 2, odd);
+        toom_add(rregister(odd), pieces[i - 2], odd);
+    }
+    toom_lsh(rregister(odd), 1, odd);
+    toom_add(rregister(even), rregister(odd), values[toom_two]);
+    if (points == 5)
+    {
+        return;
+    }
+    toom_sub(rregister(even), rregister(odd), values[toom_minus_two]);
+
+    // Horner scheme from the lowest piece gives the scaled value at 1/2.
+    wregister& half = values[toom_half];
+    asm_cp(pieces[0], half);
+    for (index_t i = 1; i < count; ++i)
+    {
+        toom_lsh(rregister(half), 1, half);
+        toom_add(rregister(half), pieces[i], half);
+    }
+}
+
+// Interpolate coefficients of the product from its values at the first points of toom_point.
+// Coefficients are written to values no longer needed and to tmp, coefficients[i] refers to the coefficient of x^i.
+static void toom_interpolate(wregister* values, index_t points, wregister* tmp, rregister* coefficients)
+{
+    wregister& v0 = values[toom_zero];
+    wregister& vinf = values[toom_infinity];
+    wregister& v1 = values[toom_one];
+    wregister& vm1 = values[toom_minus_one];
+    if (points == 4)
+    {
+        // c1 = (v1 - vm1) / 2 - c3, c2 = (v1 + vm1) / 2 - c0.
+        wregister& c1 = tmp[0];
+        wregister& c2 = tmp[1];
+        toom_sub(rregister(v1), rregister(vm1), c1);
+        toom_rsh(rregister(c1), 1, c1);
+        toom_sub(rregister(c1), rregister(vinf), c1);
+        toom_add(rregister(v1), rregister(vm1), c2);
+        toom_rsh(rregister(c2), 1, c2);
+        toom_sub(rregister(c2), rregister(v0), c2);
+        coefficients[0] = rregister(v0);
+        coefficients[1] = rregister(c1);
+        coefficients[2] = rregister(c2);
+        coefficients[3] = rregister(vinf);
+    }
+    else if (points == 5)
+    {
+        wregister& v2 = values[toom_two];
+        wregister& t1 = tmp[0];
+        wregister& t2 = tmp[1];
+        wregister& t3 = tmp[2];
+        // t3 = c1 + c2 + 3c3 + 5c4, t1 = c1 + c3, t2 = c1 + c2 + c3 + c4.
+        toom_sub(rregister(v2), rregister(vm1), t3);
+        toom_divexact(rregister(t3), 3, t3);
+        toom_sub(rregister(v1), rregister(vm1), t1);
+        toom_rsh(rregister(t1), 1, t1);
+        toom_sub(rregister(v1), rregister(v0), t2);
+        // c3 = (t3 - t2) / 2 - 2c4.
+        toom_sub(rregister(t3), rregister(t2), t3);
+        toom_rsh(rregister(t3), 1, t3);
+        toom_lsh(rregister(vinf), 1, v2);
+        toom_sub(rregister(t3), rregister(v2), t3);
+        // c2 = t2 - t1 - c4, c1 = t1 - c3.
+        toom_sub(rregister(t2), rregister(t1), t2);
+        toom_sub(rregister(t2), rregister(vinf), t2);
+        toom_sub(rregister(t1), rregister(t3), t1);
+        coefficients[0] = rregister(v0);
+        coefficients[1] = rregister(t1);
+        coefficients[2] = rregister(t2);
+        coefficients[3] = rregister(t3);
+        coefficients[4] = rregister(vinf);
+    }
+    else
+    {
+        wregister& v2 = values[toom_two];
+        wregister& vm2 = values[toom_minus_two];
+        wregister& vh = values[toom_half];
+        wregister& e1 = tmp[0];
+        wregister& o1 = tmp[1];
+        wregister& e2 = tmp[2];
+        wregister& o2 = tmp[3];
+        wregister& t = tmp[4];
+        // e1 = c0 + c2 + c4 + c6, o1 = c1 + c3 + c5.
+        toom_add(rregister(v1), rregister(vm1), e1);
+        toom_rsh(rregister(e1), 1, e1);
+        toom_sub(rregister(v1), rregister(vm1), o1);
+        toom_rsh(rregister(o1), 1, o1);
+        // e2 = c0 + 4c2 + 16c4 + 64c6, o2 = c1 + 4c3 + 16c5.
+        toom_add(rregister(v2), rregister(vm2), e2);
+        toom_rsh(rregister(e2), 1, e2);
+        toom_sub(rregister(v2), rregister(vm2), o2);
+        toom_rsh(rregister(o2), 2, o2);
+        // e1 = c2 + c4, e2 = c2 + 4c4.
+        toom_sub(rregister(e1), rregister(v0), e1);
+        toom_sub(rregister(e1), rregister(vinf), e1);
+        toom_sub(rregister(e2), rregister(v0), e2);
+        toom_lsh(rregister(vinf), 6, t);
+        toom_sub(rregister(e2), rregister(t), e2);
+        toom_rsh(rregister(e2), 2, e2);
+        // c4 = (e2 - e1) / 3, c2 = e1 - c4. Values at 1, -1, 2 and -2 are not needed anymore.
+        wregister& c4 = v1;
+        wregister& c2 = vm1;
+        wregister& c3 = v2;
+        wregister& c1 = vm2;
+        wregister& c5 = vh;
+        toom_sub(rregister(e2), rregister(e1), c4);
+        toom_divexact(rregister(c4), 3, c4);
+        toom_sub(rregister(e1), rregister(c4), c2);
+        // e2 = (vh - 64c0 - 16c2 - 4c4 - c6) / 2 = 16c1 + 4c3 + c5.
+        toom_sub(rregister(vh), rregister(vinf), e2);
+        toom_lsh(rregister(v0), 6, t);
+        toom_sub(rregister(e2), rregister(t), e2);
+        toom_lsh(rregister(c2), 4, t);
+        toom_sub(rregister(e2), rregister(t), e2);
+        toom_lsh(rregister(c4), 2, t);
+        toom_sub(rregister(e2), rregister(t), e2);
+        toom_rsh(rregister(e2), 1, e2);
+        // o2 = (o2 - o1) / 3 = c3 + 5c5, e2 = (e2 - o1) / 3 = 5c1 + c3.
+        toom_sub(rregister(o2), rregister(o1), o2);
+        toom_divexact(rregister(o2), 3, o2);
+        toom_sub(rregister(e2), rregister(o1), e2);
+        toom_divexact(rregister(e2), 3, e2);
+        // t = (e2 - o2) / 5 = c1 - c5, e1 = (e2 + o2 - 2o1) / 3 = c1 + c5.
+        toom_sub(rregister(e2), rregister(o2), t);
+        toom_divexact(rregister(t), 5, t);
+        toom_add(rregister(e2), rregister(o2), e1);
+        toom_lsh(rregister(o1), 1, e2);
+        toom_sub(rregister(e1), rregister(e2), e1);
+        toom_divexact(rregister(e1), 3, e1);
+        // c3 = o1 - (c1 + c5), c1 = (e1 + t) / 2, c5 = (e1 - t) / 2.
+        toom_sub(rregister(o1), rregister(e1), c3);
+        toom_add(rregister(e1), rregister(t), c1);
+        toom_rsh(rregister(c1), 1, c1);
+        toom_sub(rregister(e1), rregister(t), c5);
+        toom_rsh(rregister(c5), 1, c5);
+        coefficients[0] = rregister(v0);
+        coefficients[1] = rregister(c1);
+        coefficients[2] = rregister(c2);
+        coefficients[3] = rregister(c3);
+        coefficients[4] = rregister(c4);
+        coefficients[5] = rregister(c5);
+        coefficients[6] = rregister(vinf);
+    }
+}
+
+static void toom_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch);
+static void toom_sqr(const rregister& in, word_t* out, word_t* scratch);
+
+// Scratch words of a single toom_mul_split node with the given number of points and piece size.
+static inline index_t toom_split_scratch(index_t points, index_t k)
+{
+    const index_t value_size = k + 2;
+    const index_t product_size = 2 * k + 4;
+    return points * (2 * value_size + product_size) + 5 * product_size;
+}
+
+// Scratch words of every Toom-Cook split toom_mul may pick for operands of at most size words.
+static inline index_t toom_level_scratch(index_t size)
+{
+    index_t scratch = toom_split_scratch(7, (size + 3) / 4);
+    scratch = AP_MAX(scratch, toom_split_scratch(5, (size + 2) / 3));
+    scratch = AP_MAX(scratch, toom_split_scratch(4, (2 * size + 4) / 5));
+    return AP_MAX(scratch, toom_split_scratch(5, (2 * size + 6) / 7));
+}
+
+// Scratch words required by toom_mul for operands of at most size words, the whole recursion included.
+static index_t toom_scratch(index_t size)
+{
+    index_t scratch = karatsuba_scratch(size);
+    if ((size < AP_TOOM3_THRESHOLD) || (size < 3))
+    {
+        return scratch;
+    }
+    // Values are at most k + 1 words, k is at most ceil(2 * size / 5) and below size - 1.
+    const index_t child = toom_scratch(AP_MIN((2 * size + 4) / 5 + 1, size - 1));
+    scratch = AP_MAX(scratch, toom_level_scratch(size) + child);
+    // Chunks of the unbalanced path are at most 2/3 of size and are multiplied by a split, tmp takes size words.
+    const index_t chunk = (2 * size + 2) / 3;
+    return AP_MAX(scratch, size + AP_MAX(toom_level_scratch(chunk) + child, karatsuba_scratch(chunk)));
+}
+
+// Toom-Cook multiplication, left split into p pieces, right into q pieces.
+// Return: false if operands cannot be split this way.
+// Preconditions:
+// scratch holds at least toom_scratch(left.size) words.
+static bool toom_mul_split(const rregister& left, const rregister& right, word_t* out, index_t p, index_t q, word_t* scratch)
+{
+    const index_t n = left.size;
+    const index_t m = right.size;
+    const index_t k = AP_MAX((n + p - 1) / p, (m + q - 1) / q);
+    if ((n <= (p - 1) * k) || (m <= (q - 1) * k))
+    {
+        return false;
+    }
+    const index_t points = p + q - 1;
+    const index_t value_size = k + 2;
+    const index_t product_size = 2 * k + 4;
+    const index_t tmp_count = 5;
+
+    // Values of both operands, their products and temporaries for interpolation, children use the rest.
+    word_t* words = scratch;
+    wregister lvalues[toom_points];
+    wregister rvalues[toom_points];
+    wregister products[toom_points];
+    wregister tmp[tmp_count];
+    for (index_t i = 0; i < points; ++i)
+    {
+        lvalues[i] = wregister{words, value_size, 0, false};
+        words += value_size;
+        rvalues[i] = wregister{words, value_size, 0, false};
+        words += value_size;
+        products[i] = wregister{words, product_size, 0, false};
+        words += product_size;
+    }
+    for (index_t i = 0; i < tmp_count; ++i)
+    {
+        tmp[i] = wregister{words, product_size, 0, false};
+        words += product_size;
+    }
+
+    // Squares evaluate once, toom_mul squares values which refer to the same words.
+    toom_eval(left, p, k, points, lvalues, tmp);
+    if ((left.words == right.words) && (n == m) && (p == q))
+    {
+        for (index_t i = 0; i < points; ++i)
+        {
+            rvalues[i] = lvalues[i];
+        }
+    }
+    else
+    {
+        toom_eval(right, q, k, points, rvalues, tmp);
+    }
+    for (index_t i = 0; i < points; ++i)
+    {
+        toom_mul(rregister(lvalues[i]), rregister(rvalues[i]), products[i].words, words);
+        products[i].size = asm_trim(products[i].words, lvalues[i].size + rvalues[i].size);
+        products[i].sign = (lvalues[i].sign != rvalues[i].sign) && (products[i].size != 0);
+    }
+    rregister coefficients[toom_points];
+    toom_interpolate(products, points, tmp, coefficients);
+
+    // out = sum(coefficients[i] * base^(i * k)).
+    wregister result{out, index_t(n + m), 0, false};
+    asm_fill(result, 0);
+    for (index_t i = 0; i < points; ++i)
+    {
+        toom_add_at(out + i * k, n + m - i * k, coefficients[i]);
+    }
+    return true;
+}
+
+// Full product of left and right, written to out[0, left.size + right.size).
+// Algorithm is picked by the size of the shorter operand and the balance of operands.
+// Preconditions:
+// scratch holds at least toom_scratch(AP_MAX(left.size, right.size)) words.
+static void toom_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch)
+{
+    if (left.size < right.size)
+    {
+        toom_mul(right, left, out, scratch);
+        return;
+    }
+    const index_t n = left.size;
+    const index_t m = right.size;
+    if (m == 0)
+    {
+        wregister result{out, n, 0, false};
+        asm_fill(result, 0);
+        return;
+    }
+    if (m < AP_TOOM3_THRESHOLD)
+    {
+        karatsuba_mul(left, right, out, scratch);
+        return;
+    }
+    if ((left.words == right.words) && (n == m))
+    {
+        toom_sqr(left, out, scratch);
+        return;
+    }
+
+    if (n >= 3 * m)
+    {
+        // Very unbalanced operands, multiply right by chunks of left. Chunks are in [m, 2m] words.
+        const index_t count = (n + 2 * m - 1) / (2 * m);
+        const index_t chunk_size = n / count;
+        word_t* tmp = scratch;
+        rregister chunk{left.words, chunk_size, chunk_size, false};
+        toom_mul(chunk, right, out, tmp + n);
+        index_t offset = chunk_size;
+        for (index_t i = 1; i < count; ++i)
+        {
+            chunk.words = left.words + offset;
+            chunk.size = chunk_size + ((count - i) <= (n % count));
+            toom_mul(chunk, right, tmp, tmp + n);
+            // out[offset, offset + m) already holds the upper part of the previous chunk.
+            std::memcpy(out + offset + m, tmp + m, chunk.size * word_traits::bytes);
+            toom_add_at(out + offset, m + chunk.size, rregister{tmp, m, m, false});
+            offset += chunk.size;
+        }
+        return;
+    }
+
+    bool done = false;
+    if (4 * n < 5 * m)
+    {
+        if (m >= AP_TOOM4_THRESHOLD)
+        {
+            done = toom_mul_split(left, right, out, 4, 4, scratch);
+        }
+        if (!done)
+        {
+            done = toom_mul_split(left, right, out, 3, 3, scratch);
+        }
+    }
+    else if (4 * n < 7 * m)
+    {
+        done = toom_mul_split(left, right, out, 3, 2, scratch);
+    }
+    else
+    {
+        done = toom_mul_split(left, right, out, 4, 2, scratch);
+    }
+    if (!done)
+    {
+        karatsuba_mul(left, right, out, scratch);
+    }
+}
+
+// Full square of in, written to out[0, 2 * in.size). Values are squared with toom_mul.
+// Preconditions:
+// scratch holds at least toom_scratch(in.size) words.
+static void toom_sqr(const rregister& in, word_t* out, word_t* scratch)
+{
+    if (in.size < AP_TOOM3_THRESHOLD)
+    {
+        karatsuba_sqr(in, out, scratch);
+        return;
+    }
+    bool done = false;
+    if (in.size >= AP_TOOM4_THRESHOLD)
+    {
+        done = toom_mul_split(in, in, out, 4, 4, scratch);
+    }
+    if (!done)
+    {
+        done = toom_mul_split(in, in, out, 3, 3, scratch);
+    }
+    if (!done)
+    {
+        karatsuba_sqr(in, out, scratch);
+    }
+}
+
+index_t asm_sqr_toom_scratch(index_t in_size)
+{
+    return toom_scratch(in_size) + 2 * in_size;
+}
+
+dword_t asm_sqr_toom(const rregister& in, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<sqr_as_mul<toom_sqr>>(in, in, out, toom_scratch(in.size), scratch);
+}
+
+index_t asm_mul_toom_scratch(index_t left_size, index_t right_size)
+{
+    return toom_scratch(AP_MAX(left_size, right_size)) + left_size + right_size;
+}
+
+dword_t asm_mul_toom(const rregister& left, const rregister& right, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<toom_mul>(left, right, out, toom_scratch(AP_MAX(left.size, right.size)), scratch);
+}
+
+// Left shift which sets the most significant bit of nonzero word.
+static inline index_t div_clz(word_t word)
+{
+    index_t shift = 0;
+    for (; (word & (word_t{1} << (word_traits::bits - 1))) == 0; word <<= 1)
+    {
+        ++shift;
+    }
+    return shift;
+}
+
+// Reciprocal of normalized d, floor((base^2 - 1) / d) - base, Moller-Granlund.
+static inline word_t div_reciprocal(word_t d)
+{
+    const dword_t num = (dword_t{static_cast<word_t>(~d)} << word_traits::bits) | word_traits::ones;
+    return static_cast<word_t>(num / d);
+}
+
+// Reciprocal of normalized d1 * base + d0, floor((base^3 - 1) / (d1 * base + d0)) - base, Moller-Granlund.
+static inline word_t div_reciprocal(word_t d1, word_t d0)
+{
+    word_t v = div_reciprocal(d1);
+    word_t p = static_cast<word_t>(static_cast<word_t>(dword_t{d1} * v) + d0);
+    if (p < d0)
+    {
+        --v;
+        if (p >= d1)
+        {
+            --v;
+            p = static_cast<word_t>(p - d1);
+        }
+        p = static_cast<word_t>(p - d1);
+    }
+    const dword_t t = dword_t{v} * d0;
+    const word_t t1 = static_cast<word_t>(t >> word_traits::bits);
+    p = static_cast<word_t>(p + t1);
+    if (p < t1)
+    {
+        --v;
+        if ((p > d1) || ((p == d1) && (static_cast<word_t>(t) >= d0)))
+        {
+            --v;
+        }
+    }
+    return v;
+}
+
+// Division of u1 * base + u0 by normalized d with reciprocal v = div_reciprocal(d), Moller-Granlund.
+// Return: Quotient.
+// Change:
+// r = remainder.
+// Preconditions:
+// u1 < d.
+static inline word_t div_2by1(word_t u1, word_t u0, word_t d, word_t v, word_t& r)
+{
+    dword_t q = dword_t{v} * u1;
+    q += (dword_t{u1} << word_traits::bits) | u0;
+    word_t q1 = static_cast<word_t>((q >> word_traits::bits) + 1);
+    word_t rem = static_cast<word_t>(u0 - dword_t{q1} * d);
+    // Branch is taken at random, so the mask is used instead.
+    const word_t mask = static_cast<word_t>(word_t{0} - static_cast<word_t>(rem > static_cast<word_t>(q)));
+    q1 = static_cast<word_t>(q1 + mask);
+    rem = static_cast<word_t>(rem + (mask & d));
+    if (rem >= d) // unlikely
+    {
+        ++q1;
+        rem = static_cast<word_t>(rem - d);
+    }
+    r = rem;
+    return q1;
+}
+
+// Division of (u2, u1, u0) by normalized (d1, d0) with reciprocal v = div_reciprocal(d1, d0), Moller-Granlund.
+// Return: Quotient.
+// Change:
+// (r1, r0) = remainder.
+// Preconditions:
+// (u2, u1) < (d1, d0).
+static inline word_t div_3by2(word_t u2, word_t u1, word_t u0, word_t d1, word_t d0, word_t v, word_t& r1, word_t& r0)
+{
+    dword_t q = dword_t{v} * u2;
+    q += (dword_t{u2} << word_traits::bits) | u1;
+    word_t q1 = static_cast<word_t>(q >> word_traits::bits);
+    const word_t q0 = static_cast<word_t>(q);
+    const dword_t d = (dword_t{d1} << word_traits::bits) | d0;
+    dword_t r = (dword_t{static_cast<word_t>(u1 - dword_t{q1} * d1)} << word_traits::bits) | u0;
+    r = static_cast<dword_t>(r - dword_t{d0} * q1);
+    r = static_cast<dword_t>(r - d);
+    ++q1;
+    if (static_cast<word_t>(r >> word_traits::bits) >= q0)
+    {
+        --q1;
+        r = static_cast<dword_t>(r + d);
+    }
+    if (r >= d) // unlikely
+    {
+        ++q1;
+        r = static_cast<dword_t>(r - d);
+    }
+    r1 = static_cast<word_t>(r >> word_traits::bits);
+    r0 = static_cast<word_t>(r);
+    return q1;
+}
+
+// Dividend is shifted along with divisor word by word, quo may alias left.
+static void div_short_reciprocal(const rregister& left, dword_t right, wregister& quo, wregister& rem)
+{
+    const index_t shift = div_clz(static_cast<word_t>(right));
+    const index_t back = word_traits::bits - shift;
+    const word_t d = static_cast<word_t>(right << shift);
+    const word_t v = div_reciprocal(d);
+    index_t i = left.size - 1;
+    word_t r = ((shift != 0) ? static_cast<word_t>(left.words[i] >> back) : 0);
+    quo.size = AP_MIN(left.size, quo.capacity);
+
+    for (;;)
+    {
+        word_t u = static_cast<word_t>(left.words[i] << shift);
+        if ((shift != 0) && (i > 0))
+        {
+            u |= static_cast<word_t>(left.words[i - 1] >> back);
+        }
+        const word_t q = div_2by1(r, u, d, v, r);
+        if (i < quo.capacity)
+        {
+            quo.words[i] = q;
+        }
+        if (i == 0)
+        {
+            break;
+        }
+        --i;
+    }
+    rem.words[0] = static_cast<word_t>(r >> shift);
+    rem.size = 1;
+}
+
 void asm_div_short(const rregister& left, dword_t right, wregister& quo, wregister& rem)
 {
-    index_t i = left.size - 1;
+    // Double word division is a single instruction unless it is emulated, reciprocal pays off only then.
+    if (sizeof(dword_t) > sizeof(std::size_t))
+    {
+        div_short_reciprocal(left, right, quo, rem);
+        return;
+    }
+
+    index_t i = left.size - 1;
+
+    dword_t carry = left.words[i] % right;
+    if (i < quo.capacity)
+    {
+        quo.words[i] = static_cast<word_t>(left.words[i] / right);
+    }
+    quo.size = AP_MIN(left.size, quo.capacity);
+
+    while (i > 0)
+    {
+        --i;
+        carry <<= word_traits::bits;
+        carry |= left.words[i];
+        // Both are taken before the store, otherwise aliasing of quo splits them into two divisions.
+        const word_t q = static_cast<word_t>(carry / right);
+        carry %= right;
+        if (i < quo.capacity)
+        {
+            quo.words[i] = q;
+        }
+    }
+    rem.words[0] = static_cast<word_t>(carry);
+    rem.size = 1;
+}
+
+// Number theoretic transform over primes p = c * 2^k + 1 below 2^32, multiplication uses Montgomery form.
+struct ntt_prime
+{
+    std::uint32_t modulus;
+    std::uint32_t inverse; // modulus^-1 mod 2^32
+    std::uint32_t r2;      // 2^64 mod modulus
+
+    ntt_prime(std::uint32_t _modulus) : modulus(_modulus), inverse(_modulus), r2(0)
+    {
+        for (index_t bits = 3; bits < 32; bits *= 2)
+        {
+            this->inverse *= 2 - this->modulus * this->inverse;
+        }
+        std::uint64_t r = (std::uint64_t{1} << 32) % this->modulus;
+        this->r2 = static_cast<std::uint32_t>((r * r) % this->modulus);
+    }
+
+    std::uint32_t add(std::uint32_t a, std::uint32_t b) const
+    {
+        std::uint64_t sum = std::uint64_t{a} + b;
+        return static_cast<std::uint32_t>((sum >= this->modulus) ? (sum - this->modulus) : sum);
+    }
+
+    std::uint32_t sub(std::uint32_t a, std::uint32_t b) const
+    {
+        return (a >= b) ? (a - b) : (a + (this->modulus - b));
+    }
+
+    // a * b * 2^-32 mod modulus.
+    std::uint32_t mul(std::uint32_t a, std::uint32_t b) const
+    {
+        const std::uint64_t product = std::uint64_t{a} * b;
+        const std::uint32_t m = static_cast<std::uint32_t>(product) * this->inverse;
+        const std::uint32_t high = static_cast<std::uint32_t>(product >> 32);
+        const std::uint32_t correction = static_cast<std::uint32_t>((std::uint64_t{m} * this->modulus) >> 32);
+        return (high >= correction) ? (high - correction) : (high + (this->modulus - correction));
+    }
+
+    std::uint32_t to_montgomery(std::uint32_t a) const
+    {
+        return this->mul(a % this->modulus, this->r2);
+    }
+
+    std::uint32_t pow(std::uint64_t base, std::uint64_t exponent) const
+    {
+        std::uint64_t result = 1;
+        base %= this->modulus;
+        for (; exponent != 0; exponent >>= 1)
+        {
+            if (exponent & 1)
+            {
+                result = (result * base) % this->modulus;
+            }
+            base = (base * base) % this->modulus;
+        }
+        return static_cast<std::uint32_t>(result);
+    }
+};
+
+enum : index_t
+{
+    ntt_prime_count = 3,
+    ntt_piece_bits = 32,
+    // Transform length limit, 2-adic order of the smallest of the primes.
+    ntt_max_length = index_t{1} << 26
+};
+
+// Primes and their primitive roots. Their product exceeds ntt_max_length * (2^32 - 1)^2.
+static const std::uint32_t ntt_moduli[ntt_prime_count] = {3221225473u, 2013265921u, 469762049u};
+static const std::uint32_t ntt_roots[ntt_prime_count] = {5, 31, 3};
+
+// Number of 32-bit pieces needed for in.size words.
+static inline index_t ntt_pieces(index_t size)
+{
+    return (size * word_traits::bits + ntt_piece_bits - 1) / ntt_piece_bits;
+}
+
+// Transform length for operands of the given sizes, 0 if the product cannot be computed exactly.
+static inline index_t ntt_length(index_t left_size, index_t right_size)
+{
+    const index_t pieces = ntt_pieces(left_size) + ntt_pieces(right_size) - 1;
+    index_t length = 1;
+    while ((length < pieces) && (length < ntt_max_length))
+    {
+        length *= 2;
+    }
+    return (length < pieces) ? 0 : length;
+}
+
+// Bits [offset, offset + count) of words, count in [1, 32]. Bits past size words are zeros.
+template <typename T>
+static inline std::uint32_t ntt_bits(const T* words, index_t size, index_t offset, index_t count)
+{
+    static constexpr index_t width = sizeof(T) * CHAR_BIT;
+    std::uint64_t bits = 0;
+    for (index_t got = 0; got < count;)
+    {
+        const index_t i = offset / width;
+        const index_t shift = offset % width;
+        const index_t take = AP_MIN(width - shift, count - got);
+        if (i >= size)
+        {
+            break;
+        }
+        bits |= ((static_cast<std::uint64_t>(words[i] >> shift)) & ((std::uint64_t{1} << take) - 1)) << got;
+        got += take;
+        offset += take;
+    }
+    return static_cast<std::uint32_t>(bits);
+}
+
+// Split in into 32-bit pieces reduced modulo prime, out is padded with zeros up to length.
+static void ntt_split(const rregister& in, const ntt_prime& prime, std::uint32_t* out, index_t length)
+{
+    const index_t pieces = ntt_pieces(in.size);
+    for (index_t i = 0; i < pieces; ++i)
+    {
+        out[i] = ntt_bits(in.words, in.size, i * ntt_piece_bits, ntt_piece_bits) % prime.modulus;
+    }
+    std::memset(out + pieces, 0, (length - pieces) * sizeof(std::uint32_t));
+}
+
+// Join 32-bit pieces into out[0, size).
+static void ntt_join(const std::uint32_t* pieces, index_t count, word_t* out, index_t size)
+{
+    for (index_t k = 0; k < size; ++k)
+    {
+        word_t word = 0;
+        for (index_t got = 0; got < word_traits::bits; got += ntt_piece_bits)
+        {
+            const index_t take = AP_MIN(index_t(word_traits::bits) - got, index_t(ntt_piece_bits));
+            word |= static_cast<word_t>(ntt_bits(pieces, count, k * word_traits::bits + got, take)) << got;
+        }
+        out[k] = word;
+    }
+}
+
+// Fill roots[h + j] = w_2h^j for j in [0, h), h = 1, 2, ..., length / 2, in Montgomery form.
+// w_length is root, w_2h = w_4h^2.
+static void ntt_roots_table(std::uint32_t* roots, index_t length, std::uint32_t root, const ntt_prime& prime)
+{
+    const index_t half = length / 2;
+    const std::uint32_t mroot = prime.to_montgomery(root);
+    roots[half] = prime.to_montgomery(1);
+    for (index_t j = 1; j < half; ++j)
+    {
+        roots[half + j] = prime.mul(roots[half + j - 1], mroot);
+    }
+    for (index_t h = half / 2; h > 0; h /= 2)
+    {
+        for (index_t j = 0; j < h; ++j)
+        {
+            roots[h + j] = roots[2 * h + 2 * j];
+        }
+    }
+}
+
+// Forward transform, natural order to bit-reversed order. roots are filled by ntt_roots_table.
+static void ntt_forward(std::uint32_t* values, index_t length, const std::uint32_t* roots, const ntt_prime& prime)
+{
+    for (index_t half = length / 2; half > 0; half /= 2)
+    {
+        const std::uint32_t* level = roots + half;
+        for (index_t start = 0; start < length; start += 2 * half)
+        {
+            std::uint32_t* low = values + start;
+            std::uint32_t* high = low + half;
+            for (index_t j = 0; j < half; ++j)
+            {
+                const std::uint32_t u = low[j];
+                const std::uint32_t v = high[j];
+                low[j] = prime.add(u, v);
+                high[j] = prime.mul(prime.sub(u, v), level[j]);
+            }
+        }
+    }
+}
+
+// Inverse transform without scaling, bit-reversed order to natural order. roots are filled by ntt_roots_table.
+static void ntt_inverse(std::uint32_t* values, index_t length, const std::uint32_t* roots, const ntt_prime& prime)
+{
+    for (index_t half = 1; half < length; half *= 2)
+    {
+        const std::uint32_t* level = roots + half;
+        for (index_t start = 0; start < length; start += 2 * half)
+        {
+            std::uint32_t* low = values + start;
+            std::uint32_t* high = low + half;
+            for (index_t j = 0; j < half; ++j)
+            {
+                const std::uint32_t u = low[j];
+                const std::uint32_t v = prime.mul(high[j], level[j]);
+                low[j] = prime.add(u, v);
+                high[j] = prime.sub(u, v);
+            }
+        }
+    }
+}
+
+// Cyclic convolution of left and right modulo prime, written to out.
+// Preconditions:
+// out and tmp hold length words, roots hold 2 * length words.
+static void ntt_convolve(const rregister& left, const rregister& right, index_t length, index_t prime_index,
+                         std::uint32_t* out, std::uint32_t* tmp, std::uint32_t* roots)
+{
+    const ntt_prime prime{ntt_moduli[prime_index]};
+    std::uint32_t* iroots = roots + length;
+    const std::uint32_t root = prime.pow(ntt_roots[prime_index], (prime.modulus - 1) / length);
+    ntt_roots_table(roots, length, root, prime);
+    ntt_roots_table(iroots, length, prime.pow(root, prime.modulus - 2), prime);
+
+    ntt_split(left, prime, out, length);
+    ntt_forward(out, length, roots, prime);
+    if ((left.words == right.words) && (left.size == right.size))
+    {
+        // Squares transform once.
+        tmp = out;
+    }
+    else
+    {
+        ntt_split(right, prime, tmp, length);
+        ntt_forward(tmp, length, roots, prime);
+    }
+    // Pointwise products lose a factor of 2^32, scaling restores it together with division by length.
+    for (index_t i = 0; i < length; ++i)
+    {
+        out[i] = prime.mul(out[i], tmp[i]);
+    }
+    ntt_inverse(out, length, iroots, prime);
+    const std::uint32_t scale = prime.to_montgomery(prime.to_montgomery(prime.pow(length, prime.modulus - 2)));
+    for (index_t i = 0; i < length; ++i)
+    {
+        out[i] = prime.mul(out[i], scale);
+    }
+}
+
+static index_t ssa_scratch(index_t left_size, index_t right_size);
+static void ssa_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch);
+
+// Words holding 6 * length + 1 pieces of ntt_mul, with room to align them if words are shorter than pieces.
+static inline index_t ntt_buffer_words(index_t length)
+{
+    const index_t bytes = (6 * length + 1) * sizeof(std::uint32_t) + alignof(std::uint32_t) - 1;
+    return (bytes + word_traits::bytes - 1) / word_traits::bytes;
+}
+
+// Pieces of ntt_mul in scratch words, aligned for 32-bit access.
+static inline std::uint32_t* ntt_buffer(word_t* scratch)
+{
+    const std::uintptr_t mask = alignof(std::uint32_t) - 1;
+    return reinterpret_cast<std::uint32_t*>((reinterpret_cast<std::uintptr_t>(scratch) + mask) & ~mask);
+}
+
+// Scratch words required by ntt_mul, products too long for the transform are multiplied with ssa_mul.
+static inline index_t ntt_scratch(index_t left_size, index_t right_size)
+{
+    const index_t length = ntt_length(left_size, right_size);
+    return (length == 0) ? ssa_scratch(left_size, right_size) : ntt_buffer_words(length);
+}
+
+// Full product of left and right, written to out[0, left.size + right.size).
+// Convolutions modulo three primes are recombined with the Chinese remainder theorem.
+// Products too long for the transform are multiplied with ssa_mul.
+// Preconditions:
+// scratch holds at least ntt_scratch(left.size, right.size) words.
+static void ntt_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch)
+{
+    const index_t length = ntt_length(left.size, right.size);
+    if (length == 0)
+    {
+        ssa_mul(left, right, out, scratch);
+        return;
+    }
+    const std::uint64_t p0 = ntt_moduli[0];
+    const std::uint64_t p1 = ntt_moduli[1];
+    const std::uint64_t p2 = ntt_moduli[2];
+    const ntt_prime prime1{ntt_moduli[1]};
+    const ntt_prime prime2{ntt_moduli[2]};
+    // Inverses for Garner's algorithm.
+    const std::uint64_t p0_inv1 = prime1.pow(p0, p1 - 2);
+    const std::uint64_t p01_inv2 = prime2.pow((p0 * p1) % p2, p2 - 2);
+
+    // Product needs at most length + 1 pieces, tmp holds them after the convolutions.
+    std::uint32_t* buffer = ntt_buffer(scratch);
+    std::uint32_t* residues[ntt_prime_count] = {buffer, buffer + length, buffer + 2 * length};
+    std::uint32_t* roots = buffer + 3 * length;
+    std::uint32_t* tmp = buffer + 5 * length;
+    for (index_t i = 0; i < ntt_prime_count; ++i)
+    {
+        ntt_convolve(left, right, length, i, residues[i], tmp, roots);
+    }
+
+    // Recombine each coefficient x = r0 + p0 * (v1 + p1 * v2) and propagate carries through 32-bit pieces.
+    const index_t size = left.size + right.size;
+    const index_t pieces = ntt_pieces(size);
+    std::uint64_t carry = 0;
+    for (index_t i = 0; i < pieces; ++i)
+    {
+        std::uint64_t x0 = 0;
+        std::uint64_t x1 = 0;
+        std::uint64_t x2 = 0;
+        if (i < length)
+        {
+            const std::uint64_t r0 = residues[0][i];
+            const std::uint64_t v1 = (((residues[1][i] + p1 - (r0 % p1)) % p1) * p0_inv1) % p1;
+            const std::uint64_t v2 = (((residues[2][i] + p2 - ((r0 + p0 * v1) % p2)) % p2) * p01_inv2) % p2;
+            // t = v1 + p1 * v2 < 2^64, x = r0 + p0 * t.
+            const std::uint64_t t = v1 + p1 * v2;
+            const std::uint64_t low = p0 * (t & 0xFFFFFFFFu) + r0;
+            const std::uint64_t high = p0 * (t >> 32) + (low >> 32);
+            x0 = low & 0xFFFFFFFFu;
+            x1 = high & 0xFFFFFFFFu;
+            x2 = high >> 32;
+        }
+        const std::uint64_t sum = x0 + (carry & 0xFFFFFFFFu);
+        carry = (carry >> 32) + x1 + (x2 << 32) + (sum >> 32);
+        tmp[i] = static_cast<std::uint32_t>(sum);
+    }
+    ntt_join(tmp, pieces, out, size);
+}
+
+index_t asm_mul_ntt_scratch(index_t left_size, index_t right_size)
+{
+    return ntt_scratch(left_size, right_size) + left_size + right_size;
+}
+
+dword_t asm_mul_ntt(const rregister& left, const rregister& right, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<ntt_mul>(left, right, out, ntt_scratch(left.size, right.size), scratch);
+}
+
+// Schoenhage-Strassen helpers. Residues modulo 2^N + 1 take size words, N = (size - 1) * word_traits::bits.
+// Residues are kept in [0, 2^N], so their top word is either 0 or 1.
+
+// Transform of 2^k residues, each residue receives piece words of an operand.
+struct ssa_params
+{
+    index_t k;
+    index_t piece;
+    index_t size;
+};
+
+// Pick parameters for a product of total words by a rough estimate of transform and pointwise costs.
+static ssa_params ssa_choose(index_t total)
+{
+    ssa_params best{0, 0, 0};
+    index_t best_cost = 0;
+    for (index_t k = 1;; ++k)
+    {
+        const index_t length = index_t{1} << k;
+        const index_t piece = (total + length - 1) / length;
+        // Coefficients of the cyclic convolution are below 2^(2 * piece bits + k) and must not wrap around 2^N + 1.
+        // Roots of unity are powers of 2 only when N is a multiple of length / 2.
+        const index_t align = AP_MAX(index_t(word_traits::bits), length / 2);
+        const index_t bits = ((2 * piece * word_traits::bits + k + align - 1) / align) * align;
+        const index_t size = bits / word_traits::bits + 1;
+        index_t root = 1;
+        while (root * root < size)
+        {
+            ++root;
+        }
+        const index_t cost = length * size * (2 * k + root);
+        if ((best.size == 0) || (cost < best_cost))
+        {
+            best = ssa_params{k, piece, size};
+            best_cost = cost;
+        }
+        if (piece == 1)
+        {
+            return best;
+        }
+    }
+}
+
+// x = x + 2^N + 1 if x has wrapped below zero. Wrapped residues have the upper bits of their top word set.
+static inline void ssa_fix(word_t* x, index_t size)
+{
+    if (x[size - 1] > 1)
+    {
+        for (index_t i = 0; (i < size) && (++x[i] == 0); ++i)
+        {
+        }
+        ++x[size - 1];
+    }
+}
+
+// out = left - right modulo 2^N + 1.
+static inline void ssa_sub(const word_t* left, const word_t* right, word_t* out, index_t size)
+{
+    wregister result{out, size, 0, false};
+    asm_sub(rregister{left, size, size, false}, rregister{right, size, size, false}, result);
+    ssa_fix(out, size);
+}
+
+// out = left + right modulo 2^N + 1.
+static inline void ssa_add(const word_t* left, const word_t* right, word_t* out, index_t size)
+{
+    wregister result{out, size, 0, false};
+    asm_add(rregister{left, size, size, false}, rregister{right, size, size, false}, result);
+    // Sum is at most 2^(N + 1), 2^N is -1.
+    const word_t top = out[size - 1];
+    out[size - 1] = 0;
+    asm_sub(rregister(result), rregister{&top, 1, 1, false}, result);
+    ssa_fix(out, size);
+}
+
+// out = in * 2^shift modulo 2^N + 1, shift in [0, 2N).
+// Preconditions:
+// tmp holds 2 * size words.
+static void ssa_shift(const word_t* in, index_t shift, word_t* out, index_t size, word_t* tmp)
+{
+    const index_t half = size - 1;
+    const index_t bits = half * word_traits::bits;
+    const bool negate = (shift >= bits);
+    shift %= bits;
+    // in * 2^shift = low + high * 2^N, high is below 2^N, 2^N is -1.
+    wregister full{tmp, index_t(2 * size), 0, false};
+    asm_fill(full, 0);
+    word_t* shifted = tmp + shift / word_traits::bits;
+    std::memcpy(shifted, in, size * word_traits::bytes);
+    if (shift % word_traits::bits != 0)
+    {
+        wregister part{shifted, index_t(size + 1), 0, false};
+        asm_lsh(rregister{shifted, size, size, false}, shift % word_traits::bits, part);
+    }
+    std::memcpy(out, tmp, half * word_traits::bytes);
+    out[half] = 0;
+    if (negate)
+    {
+        ssa_sub(tmp + half, out, out, size);
+    }
+    else
+    {
+        ssa_sub(out, tmp + half, out, size);
+    }
+}
+
+// Forward transform, natural order to bit-reversed order. Root of unity of order 2h is 2^(N / h).
+// Preconditions:
+// tmp holds 3 * size words.
+static void ssa_forward(word_t* values, index_t length, index_t size, word_t* tmp)
+{
+    const index_t bits = (size - 1) * word_traits::bits;
+    for (index_t half = length / 2; half > 0; half /= 2)
+    {
+        for (index_t start = 0; start < length; start += 2 * half)
+        {
+            for (index_t j = 0; j < half; ++j)
+            {
+                word_t* low = values + (start + j) * size;
+                word_t* high = low + half * size;
+                ssa_sub(low, high, tmp, size);
+                ssa_add(low, high, low, size);
+                ssa_shift(tmp, j * (bits / half), high, size, tmp + size);
+            }
+        }
+    }
+}
+
+// Inverse transform without scaling, bit-reversed order to natural order.
+// Preconditions:
+// tmp holds 3 * size words.
+static void ssa_inverse(word_t* values, index_t length, index_t size, word_t* tmp)
+{
+    const index_t bits = (size - 1) * word_traits::bits;
+    for (index_t half = 1; half < length; half *= 2)
+    {
+        for (index_t start = 0; start < length; start += 2 * half)
+        {
+            for (index_t j = 0; j < half; ++j)
+            {
+                word_t* low = values + (start + j) * size;
+                word_t* high = low + half * size;
+                const index_t shift = j * (bits / half);
+                ssa_shift(high, (shift == 0) ? 0 : 2 * bits - shift, tmp, size, tmp + size);
+                ssa_sub(low, tmp, high, size);
+                ssa_add(low, tmp, low, size);
+            }
+        }
+    }
+}
+
+// Scratch words required by ssa_mul_mod for residues of size words.
+static inline index_t ssa_mul_mod_scratch(index_t size)
+{
+    const index_t half = size - 1;
+    return 2 * half + 1 + ((half < AP_NTT_THRESHOLD) ? toom_scratch(half) : ntt_scratch(half, half));
+}
 
-    dword_t carry = left.words[i] % right;
-    if (i < quo.capacity)
+// out = left * right modulo 2^N + 1, out may be left.
+// Preconditions:
+// scratch holds at least ssa_mul_mod_scratch(size) words.
+static void ssa_mul_mod(const word_t* left, const word_t* right, word_t* out, index_t size, word_t* scratch)
+{
+    const index_t half = size - 1;
+    word_t* product = scratch;
+    wregister full{product, index_t(2 * half + 1), 0, false};
+    asm_fill(full, 0);
+    // 2^N is -1.
+    if ((left[half] != 0) || (right[half] != 0))
     {
-        quo.words[i] = static_cast<word_t>(left.words[i] / right);
+        ssa_sub(product, (left[half] != 0) ? right : left, out, size);
+        return;
     }
-    quo.size = AP_MIN(left.size, quo.capacity);
+    rregister lvalue{left, half, asm_trim(left, half), false};
+    rregister rvalue{right, half, asm_trim(right, half), false};
+    if (lvalue.size < rvalue.size)
+    {
+        std::swap(lvalue, rvalue);
+    }
+    if (rvalue.size != 0)
+    {
+        if (half < AP_NTT_THRESHOLD)
+        {
+            toom_mul(lvalue, rvalue, product, scratch + full.capacity);
+        }
+        else
+        {
+            ntt_mul(lvalue, rvalue, product, scratch + full.capacity);
+        }
+    }
+    // product = low + high * 2^N, high is below 2^N.
+    std::memcpy(out, product, half * word_traits::bytes);
+    out[half] = 0;
+    ssa_sub(out, product + half, out, size);
+}
 
-    while (i > 0)
+// Scratch words required by ssa_mul.
+static index_t ssa_scratch(index_t left_size, index_t right_size)
+{
+    const ssa_params params = ssa_choose(left_size + right_size);
+    const index_t length = index_t{1} << params.k;
+    return 2 * length * params.size + AP_MAX(3 * params.size, ssa_mul_mod_scratch(params.size));
+}
+
+// Split in into length residues of piece words each.
+static void ssa_split(const rregister& in, index_t piece, word_t* values, index_t length, index_t size)
+{
+    wregister all{values, index_t(length * size), 0, false};
+    asm_fill(all, 0);
+    for (index_t i = 0, offset = 0; offset < in.size; ++i, offset += piece)
     {
-        --i;
-        carry <<= word_traits::bits;
-        carry |= left.words[i];
-        if (i < quo.capacity)
+        std::memcpy(values + i * size, in.words + offset, AP_MIN(piece, in.size - offset) * word_traits::bytes);
+    }
+}
+
+// Full product of left and right, written to out[0, left.size + right.size).
+// Cyclic convolution of pieces is computed modulo 2^N + 1, where twiddle factors are powers of 2 and multiplication by
+// them is a shift. Pointwise products are multiplied with toom_mul or ntt_mul and reduced modulo 2^N + 1.
+// Preconditions:
+// scratch holds at least ssa_scratch(left.size, right.size) words.
+static void ssa_mul(const rregister& left, const rregister& right, word_t* out, word_t* scratch)
+{
+    const index_t total = left.size + right.size;
+    const ssa_params params = ssa_choose(total);
+    const index_t length = index_t{1} << params.k;
+    const index_t size = params.size;
+    word_t* lvalues = scratch;
+    word_t* rvalues = lvalues + length * size;
+    word_t* tmp = rvalues + length * size;
+
+    ssa_split(left, params.piece, lvalues, length, size);
+    ssa_forward(lvalues, length, size, tmp);
+    if ((left.words == right.words) && (left.size == right.size))
+    {
+        // Squares transform once.
+        rvalues = lvalues;
+    }
+    else
+    {
+        ssa_split(right, params.piece, rvalues, length, size);
+        ssa_forward(rvalues, length, size, tmp);
+    }
+    for (index_t i = 0; i < length; ++i)
+    {
+        ssa_mul_mod(lvalues + i * size, rvalues + i * size, lvalues + i * size, size, tmp);
+    }
+    ssa_inverse(lvalues, length, size, tmp);
+
+    // Coefficients are exact after scaling by 1 / length = 2^(2N - k), out = sum(coefficients[i] * base^(i * piece)).
+    wregister result{out, total, 0, false};
+    asm_fill(result, 0);
+    const index_t bits = (size - 1) * word_traits::bits;
+    for (index_t i = 0, offset = 0; (i < length) && (offset < total); ++i, offset += params.piece)
+    {
+        ssa_shift(lvalues + i * size, 2 * bits - params.k, tmp, size, tmp + size);
+        const index_t count = asm_trim(tmp, size);
+        toom_add_at(out + offset, total - offset, rregister{tmp, count, count, false});
+    }
+}
+
+index_t asm_mul_ssa_scratch(index_t left_size, index_t right_size)
+{
+    return ssa_scratch(left_size, right_size) + left_size + right_size;
+}
+
+dword_t asm_mul_ssa(const rregister& left, const rregister& right, wregister& out, word_t* scratch)
+{
+    return asm_mul_wrapped<ssa_mul>(left, right, out, ssa_scratch(left.size, right.size), scratch);
+}
+
+void asm_divexact_short(const rregister& left, word_t right, wregister& out)
+{
+    // Inverse of right modulo base, Newton iteration doubles the number of correct bits (3 for any odd right).
+    dword_t inverse = right;
+    for (index_t bits = 3; bits < word_traits::bits; bits *= 2)
+    {
+        inverse = static_cast<word_t>(inverse * static_cast<word_t>(2 - right * inverse));
+    }
+    dword_t carry = 0;
+    for (index_t i = 0; i < left.size; ++i)
+    {
+        const dword_t word = left.words[i];
+        const dword_t borrow = (word < carry);
+        const word_t quotient = static_cast<word_t>(static_cast<word_t>(word - carry) * inverse);
+        out.words[i] = quotient;
+        carry = ((dword_t{quotient} * right) >> word_traits::bits) + borrow;
+    }
+    out.size = left.size;
+}
+
+// out = out - in * q over size words.
+// Return: Borrow word.
+static inline word_t div_submul(word_t* out, const word_t* in, index_t size, word_t q)
+{
+    dword_t carry = 0;
+    for (index_t i = 0; i < size; ++i)
+    {
+        carry += dword_t{in[i]} * q;
+        const word_t low = static_cast<word_t>(carry);
+        carry >>= word_traits::bits;
+        carry += (out[i] < low);
+        out[i] = static_cast<word_t>(out[i] - low);
+    }
+    return static_cast<word_t>(carry);
+}
+
+// Schoolbook division of num[0, size) by normalized den, Knuth's algorithm D. Quotient word is estimated by 3/2 division
+// with precomputed reciprocal, which also yields the upper two words of the partial remainder.
+// Return: Most significant word of quotient, 0 or 1.
+// Change:
+// quo[0, size - den.size) holds the rest of quotient.
+// num[0, den.size) holds remainder.
+// Preconditions:
+// Most significant bit of den is set.
+// den.size in [2, size].
+static word_t div_schoolbook(word_t* num, index_t size, const rregister& den, word_t* quo)
+{
+    const index_t dn = den.size;
+    wregister top{num + size - dn, dn, dn, false};
+    const word_t qh = (asm_cmp(rregister(top), den).result != cmpres::less);
+    if (qh != 0)
+    {
+        asm_sub(rregister(top), den, top);
+    }
+
+    const word_t d1 = den.words[dn - 1];
+    const word_t d0 = den.words[dn - 2];
+    const word_t v = div_reciprocal(d1, d0);
+    const rregister dlow{den.words, index_t(dn - 1), index_t(dn - 1), false};
+    for (index_t j = size - dn; j > 0;)
+    {
+        --j;
+        word_t* window = num + j;
+        const word_t u2 = window[dn];
+        const word_t u1 = window[dn - 1];
+        word_t q = word_traits::ones;
+        if ((u2 == d1) && (u1 == d0)) // unlikely, quotient word is base - 1
         {
-            quo.words[i] = static_cast<word_t>(carry / right);
+            window[dn] = static_cast<word_t>(u2 - div_submul(window, den.words, dn, q));
         }
-        carry %= right;
+        else
+        {
+            word_t r1 = 0;
+            word_t r0 = 0;
+            q = div_3by2(u2, u1, window[dn - 2], d1, d0, v, r1, r0);
+            const word_t borrow = div_submul(window, den.words, dn - 2, q);
+            const word_t borrow0 = (r0 < borrow);
+            window[dn - 2] = static_cast<word_t>(r0 - borrow);
+            const word_t borrow1 = (r1 < borrow0);
+            window[dn - 1] = static_cast<word_t>(r1 - borrow0);
+            window[dn] = 0;
+            if (borrow1 != 0) // unlikely
+            {
+                --q;
+                wregister acc{window, index_t(dn - 1), index_t(dn - 1), false};
+                const dword_t carry = asm_add(rregister(acc), dlow, acc);
+                window[dn - 1] = static_cast<word_t>(window[dn - 1] + d1 + carry);
+            }
+        }
+        quo[j] = q;
     }
-    rem.words[0] = static_cast<word_t>(carry);
-    rem.size = 1;
+    return qh;
 }
 
-void asm_div(const rregister& left, const rregister& right, wregister& quo, wregister& rem)
+index_t asm_div_scratch(index_t left_size, index_t right_size)
+{
+    // Normalized operands and quotient.
+    return (left_size + 1) + right_size + (left_size + 1 - right_size);
+}
+
+void asm_div(const rregister& left, const rregister& right, wregister& quo, wregister& rem, word_t* scratch)
 {
-    static constexpr index_t borrow_shift = dword_traits::bits - 1;
     static constexpr dword_t base = dword_t{word_traits::ones} + 1;
     const dword_t normalizer = ((base / 2) / right.words[right.size - 1]) + ((base / 2) % right.words[right.size - 1] != 0);
+    const index_t count = left.size + 1 - right.size;
 
-    // Normalize dividend (left).
-    auto nleft_digits = array_alloc<word_t>(left.size + 1);
-    wregister nleft{nleft_digits.get(), index_t(left.size + 1), 0, false};
+    // Normalized operands and quotient, if it does not fit into quo.
+    const bool direct = (quo.capacity >= count);
+    auto buffer = array_null<word_t>();
+    if (scratch == nullptr)
+    {
+        buffer = array_alloc<word_t>(left.size + 1 + right.size + (direct ? 0 : count));
+        scratch = buffer.get();
+    }
+    wregister nleft{scratch, index_t(left.size + 1), 0, false};
     asm_mul_short(left, normalizer, nleft);
-    dword_t u2 = 0;
-    dword_t u1 = 0;
-    dword_t u0 = 0;
-
-    // Normalize divisor (right).
-    auto nright_digits = array_alloc<word_t>(right.size);
-    wregister nright{nright_digits.get(), right.size, 0, false};
+    wregister nright{nleft.words + nleft.capacity, right.size, 0, false};
     asm_mul_short(right, normalizer, nright);
-    const dword_t v1 = nright.words[nright.size - 1];
-    const dword_t v0 = nright.words[nright.size - 2];
+    word_t* q = (direct ? quo.words : nright.words + right.size);
+
+    // Upper right.size words of nleft are less than nright.
+    div_schoolbook(nleft.words, nleft.capacity, rregister(nright), q);
+    quo.size = AP_MIN(count, quo.capacity);
+    if (!direct && (quo.size != 0))
+    {
+        std::memcpy(quo.words, q, quo.size * word_traits::bytes);
+    }
+    nleft.size = right.size;
+    asm_div_short(rregister(nleft), normalizer, rem, nright);
+}
+
+// Full product of left and right by the kernel uinteger_mul would pick, written to out[0, left.size + right.size).
+// Preconditions:
+// scratch holds at least mul_scratch(AP_MAX(left.size, right.size)) words.
+static void mul_any(const rregister& left, const rregister& right, word_t* out, word_t* scratch)
+{
+    if (left.size < right.size)
+    {
+        mul_any(right, left, out, scratch);
+    }
+    else if (right.size < AP_NTT_THRESHOLD)
+    {
+        toom_mul(left, right, out, scratch);
+    }
+    else
+    {
+        ntt_mul(left, right, out, scratch);
+    }
+}
+
+// Scratch words required by mul_any for operands of at most size words.
+static inline index_t mul_scratch(index_t size)
+{
+    return AP_MAX(toom_scratch(size), (size < AP_NTT_THRESHOLD) ? 0 : ntt_scratch(size, size));
+}
+
+// out = out - in over size words.
+// Return: Borrow.
+static inline dword_t div_sub(word_t* out, const word_t* in, index_t size)
+{
+    static constexpr index_t borrow_shift = dword_traits::bits - 1;
+    dword_t borrow = 0;
+    for (index_t i = 0; i < size; ++i)
+    {
+        borrow = out[i] - borrow;
+        borrow -= in[i];
+        out[i] = static_cast<word_t>(borrow);
+        borrow >>= borrow_shift;
+    }
+    return borrow;
+}
 
-    // Single division step context.
+// Division of num[0, den.size + count) by normalized den, count in [1, den.size], Burnikel-Ziegler algorithm.
+// Balanced division is split into two halves. Quotient of a shorter division is estimated with the upper count words of
+// den and corrected by the product of quotient and the lower words of den.
+// Return: Most significant word of quotient, 0 or 1.
+// Change:
+// quo[0, count) holds the rest of quotient.
+// num[0, den.size) holds remainder.
+// Preconditions:
+// Most significant bit of den is set.
+// tmp holds at least den.size + mul_scratch(den.size) words.
+static word_t div_bz(word_t* num, index_t count, const rregister& den, word_t* quo, word_t* tmp)
+{
+    const index_t dn = den.size;
+    if (count < AP_BZ_THRESHOLD)
+    {
+        return div_schoolbook(num, dn + count, den, quo);
+    }
+    if (count == dn)
+    {
+        const index_t low = count / 2;
+        const word_t qh = div_bz(num + low, count - low, den, quo + low, tmp);
+        div_bz(num, low, den, quo, tmp);
+        return qh;
+    }
 
-    // Difference in size of normalized operands. "+ 1" because u2 acts as extra most significant word of rem.
-    const index_t size_diff = (nleft.size - nright.size);
-    index_t j = 0;      // Number of single-word divisions.
-    index_t i = 0;      // Iterator for single-word divisions.
-    dword_t q = 0;      // Single-word quotient, written to rem at the end of iteration.
-    dword_t r = 0;      // Single word remainder, used in q approximation.
-    dword_t carry = 0;  // Used in multiply-subtract part of single-word division.
-    dword_t borrow = 0; // Used in multiply-subtract part of single-word division.
+    const index_t low_size = dn - count;
+    const rregister dhigh{den.words + low_size, count, count, false};
+    const rregister dlow{den.words, low_size, low_size, false};
+    word_t qh = div_bz(num + low_size, count, dhigh, quo, tmp);
 
-    for (j = size_diff; j > 0;)
+    // num -= (qh * base^count + quo) * dlow, estimate exceeds quotient by a few units at most.
+    mul_any(rregister{quo, count, count, false}, dlow, tmp, tmp + dn);
+    dword_t borrow = div_sub(num, tmp, dn);
+    if (qh != 0)
     {
-        --j;
-        i = j + nright.size;
-        u2 = nleft.words[i];
-        u1 = nleft.words[i - 1];
-        u0 = nleft.words[i - 2];
-        q = u2;
-        q <<= word_traits::bits;
-        q += u1;
-        r = q % v1;
-        q /= v1;
-        if (q == base || q * v0 > (base * r + u0))
-        {
-            --q;
-            r += v1;
-            if (r < base)
-            {
-                if (q == base || q * v0 > (base * r + u0))
-                {
-                    --q;
-                    r += v1;
-                }
-            }
+        borrow += div_sub(num + count, dlow.words, low_size);
+    }
+    wregister rest{num, dn, dn, false};
+    while (borrow != 0)
+    {
+        index_t i = 0;
+        while ((i < count) && (quo[i]-- == 0))
+        {
+            ++i;
+        }
+        qh -= (i == count);
+        borrow -= asm_add(rregister(rest), den, rest);
+    }
+    return qh;
+}
+
+// Left shift which sets the most significant bit of in.
+// Preconditions:
+// Trimmed in.
+static inline index_t div_shift(const rregister& in)
+{
+    return div_clz(in.words[in.size - 1]);
+}
+
+// out = in << shift, shift in [0, word_traits::bits), out.capacity words are written.
+// Preconditions:
+// out.capacity in [in.size, in.size + 1].
+static inline void div_normalize(const rregister& in, index_t shift, wregister& out)
+{
+    if (shift != 0)
+    {
+        asm_lsh(in, shift, out);
+    }
+    else
+    {
+        asm_cp(in, out);
+        if (out.capacity > in.size)
+        {
+            out.words[in.size] = 0;
+            ++out.size;
+        }
+    }
+}
+
+// out = in >> shift, shift in [0, word_traits::bits). Words beyond capacity of out are dropped.
+static inline void div_denormalize(const rregister& in, index_t shift, wregister& out)
+{
+    if (shift != 0)
+    {
+        const index_t size = AP_MIN(in.size, out.capacity + 1);
+        const rregister part{in.words, size, size, false};
+        asm_rsh(part, shift, out);
+    }
+    else
+    {
+        const index_t size = AP_MIN(in.size, out.capacity);
+        const rregister part{in.words, size, size, false};
+        asm_cp(part, out);
+    }
+}
+
+// Scratch words required by div_invert for divisors of size words.
+static inline index_t div_invert_scratch(index_t size)
+{
+    return 4 * size + 5 + mul_scratch(2 * size);
+}
+
+// x = x + 1 over size words.
+// Return: Carry.
+static inline word_t div_increment(word_t* x, index_t size)
+{
+    for (index_t i = 0; i < size; ++i)
+    {
+        if (++x[i] != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// x = x - 1 over size words.
+// Return: Borrow.
+static inline word_t div_decrement(word_t* x, index_t size)
+{
+    for (index_t i = 0; i < size; ++i)
+    {
+        if (x[i]-- != 0)
+        {
+            return 0;
         }
-        i = j;
-        borrow = 0;
-        carry = 0;
-        for (index_t k = 0; k < right.size; ++k, ++i)
+    }
+    return 1;
+}
+
+// Approximate reciprocal of normalized den: out[0, den.size) is a few units off floor((base^(2n) - 1) / den) - base^n.
+// Reciprocal X_h of the upper h words of den is refined by Newton iteration, X = X_h + X_h * e / base^(2h), where
+// e = base^(n + h) - den * X_h. Lower h words of e do not affect X by more than a unit and are dropped. With h > n / 2 the
+// error of X_h is squared below a unit, so errors do not build up through recursion.
+// Preconditions:
+// Most significant bit of den is set.
+// tmp holds at least div_invert_scratch(den.size) words.
+static void div_invert_approx(const rregister& den, word_t* out, word_t* tmp)
+{
+    const index_t n = den.size;
+    if ((n < AP_NEWTON_THRESHOLD) || (n < 3))
+    {
+        // base^(2n) - 1 - base^n * den has the complement of den in its upper half.
+        wregister high{tmp + n, n, 0, false};
+        asm_not(den, high);
+        wregister low{tmp, n, 0, false};
+        asm_fill(low, word_traits::ones);
+        if (n == 1)
         {
-            borrow = nleft.words[i] - borrow;
-            carry += nright.words[k] * q;
-            borrow -= static_cast<word_t>(carry);
-            nleft.words[i] = static_cast<word_t>(borrow);
-            borrow >>= borrow_shift;
-            carry >>= (word_traits::bits);
+            const dword_t num = (dword_t{tmp[1]} << word_traits::bits) | tmp[0];
+            out[0] = static_cast<word_t>(num / den.words[0]);
         }
-        borrow += carry;
-        if (borrow != 0)
+        else
         {
-            if (nleft.words[i] >= borrow)
-            {
-                nleft.words[i] -= static_cast<word_t>(borrow);
-            }
-            else // unlikely
-            {
-                --q;
-                i = j;
-                carry = 0;
-                for (size_t k = 0; k < right.size; ++k, ++i)
-                {
-                    carry += nleft.words[i];
-                    carry += nright.words[k];
-                    nleft.words[i] = static_cast<word_t>(carry);
-                    carry >>= word_traits::bits;
-                }
-                nleft.words[i] += static_cast<word_t>(carry);
-                nleft.words[i] -= static_cast<word_t>(borrow);
-            }
+            div_bz(tmp, n, den, out, tmp + 2 * n);
+        }
+        return;
+    }
+
+    // X_h = base^h + out[l, n).
+    const index_t h = n / 2 + 1;
+    const index_t l = n - h;
+    div_invert_approx(rregister{den.words + l, h, h, false}, out + l, tmp);
+    const rregister vh{out + l, h, h, false};
+
+    // Magnitude of e is about base^n.
+    word_t* e = tmp;
+    word_t* c = e + n + h + 1;
+    word_t* scratch = c + n + 2 * h + 1;
+    mul_any(den, vh, e, scratch);
+    e[n + h] = 0;
+    wregister acc{e + h, index_t(n + 1), index_t(n + 1), false};
+    asm_add(rregister(acc), den, acc);
+    const bool negative = (e[n + h] != 0);
+    if (negative)
+    {
+        --e[n + h];
+    }
+    else
+    {
+        wregister all{e, index_t(n + h), 0, false};
+        asm_twos(rregister{e, index_t(n + h), index_t(n + h), false}, all);
+    }
+    const index_t e_size = asm_trim(e + h, n);
+
+    // c = X_h * e / base^(2h) = (e + v_h * e / base^h) / base^h, it is less than base^n.
+    index_t c_size = 0;
+    if (e_size != 0)
+    {
+        const rregister er{e + h, e_size, e_size, false};
+        mul_any(vh, er, c, scratch);
+        c[h + e_size] = 0;
+        wregister cacc{c + h, index_t(e_size + 1), index_t(e_size + 1), false};
+        asm_add(rregister{c + h, e_size, e_size, false}, er, cacc);
+        c_size = AP_MIN(asm_trim(c + h, e_size + 1), n);
+    }
+
+    // X = X_h * base^l +- c, it is kept in [base^n, 2 * base^n).
+    std::memset(out, 0, l * word_traits::bytes);
+    word_t top = 1;
+    if (negative)
+    {
+        word_t borrow = static_cast<word_t>(div_sub(out, c + h, c_size));
+        if ((borrow != 0) && (c_size < n))
+        {
+            borrow = div_decrement(out + c_size, n - c_size);
+        }
+        top -= borrow;
+    }
+    else
+    {
+        wregister xr{out, n, n, false};
+        top += static_cast<word_t>(asm_add(rregister(xr), rregister{c + h, c_size, c_size, false}, xr));
+    }
+    if (top != 1)
+    {
+        wregister xr{out, n, 0, false};
+        asm_fill(xr, (top == 0) ? word_t{0} : word_t{word_traits::ones});
+    }
+}
+
+// Reciprocal of normalized den: out[0, den.size) = floor((base^(2n) - 1) / den) - base^n.
+// Approximation is fixed by the product of den and reciprocal, it is a few units off base^(2n) - 1.
+// Preconditions:
+// Most significant bit of den is set.
+// tmp holds at least div_invert_scratch(den.size) words.
+static void div_invert(const rregister& den, word_t* out, word_t* tmp)
+{
+    div_invert_approx(den, out, tmp);
+    if ((den.size < AP_NEWTON_THRESHOLD) || (den.size < 3))
+    {
+        return;
+    }
+
+    const index_t n = den.size;
+    const rregister x{out, n, n, false};
+    word_t* product = tmp;
+    mul_any(x, den, product, tmp + 2 * n + 1);
+    product[2 * n] = 0;
+    wregister high{product + n, index_t(n + 1), index_t(n + 1), false};
+    asm_add(rregister(high), den, high);
+
+    // Product must not exceed base^(2n) - 1.
+    while (product[2 * n] != 0)
+    {
+        div_decrement(out, n);
+        if (div_sub(product, den.words, n) != 0)
+        {
+            div_decrement(product + n, n + 1);
+        }
+    }
+    // Remainder base^(2n) - 1 - product must be less than den.
+    wregister rest{product, index_t(2 * n), 0, false};
+    asm_not(rregister{product, index_t(2 * n), index_t(2 * n), false}, rest);
+    rest.size = asm_trim(rest.words, rest.size);
+    while ((rest.size > n) || ((rest.size == n) && (asm_cmp(rregister(rest), den).result != cmpres::less)))
+    {
+        div_increment(out, n);
+        asm_sub(rregister(rest), den, rest);
+        rest.size = asm_trim(rest.words, rest.size);
+    }
+}
+
+// Division of num[0, 2 * den.size) by normalized den with its reciprocal, Barrett's algorithm.
+// Quotient is estimated by the product of upper half of num and reciprocal, the estimate is a few units less.
+// Change:
+// quo[0, den.size) holds quotient.
+// num[0, den.size) holds remainder.
+// Preconditions:
+// Most significant bit of den is set.
+// Upper den.size words of num are less than den.
+// tmp holds at least 2 * den.size + mul_scratch(den.size) words.
+static void div_barrett(word_t* num, const rregister& den, const word_t* inverse, word_t* quo, word_t* tmp)
+{
+    const index_t n = den.size;
+    const rregister high{num + n, n, n, false};
+    word_t* product = tmp;
+    word_t* scratch = tmp + 2 * n;
+    mul_any(high, rregister{inverse, n, n, false}, product, scratch);
+    wregister q{quo, n, n, false};
+    asm_add(high, rregister{product + n, n, n, false}, q);
+
+    // Remainder is less than a few den, it fits into n + 1 words.
+    mul_any(rregister(q), den, product, scratch);
+    div_sub(num, product, n + 1);
+    while ((num[n] != 0) || (asm_cmp(rregister{num, n, n, false}, den).result != cmpres::less))
+    {
+        div_increment(quo, n);
+        num[n] -= static_cast<word_t>(div_sub(num, den.words, n));
+    }
+}
+
+// Scratch words required by div_long.
+static inline index_t div_long_scratch(index_t left_size, index_t right_size, bool inverse)
+{
+    const index_t size = left_size + 1;
+    return size + right_size + (inverse ? 2 * right_size : right_size) + mul_scratch(right_size) + (size - right_size);
+}
+
+// Long division by blocks of right.size words, upper block goes first. Blocks are divided by Barrett's algorithm with
+// inverse, if it is not null and right is long enough, and by Burnikel-Ziegler algorithm otherwise. Scratch is allocated,
+// if it is null.
+static void div_long(const rregister& left, const rregister& right, const word_t* inverse, wregister& quo,
+                     wregister& rem, word_t* scratch)
+{
+    const index_t dn = right.size;
+    const index_t size = left.size + 1;
+    const index_t count = size - dn;
+    const index_t shift = div_shift(right);
+
+    // Normalized operands, temporaries and quotient, if it does not fit into quo.
+    const bool direct = (quo.capacity >= count);
+    const index_t tmp_size = ((inverse != nullptr) ? 2 * dn : dn) + mul_scratch(dn);
+    auto buffer = array_null<word_t>();
+    if (scratch == nullptr)
+    {
+        buffer = array_alloc<word_t>(size + dn + tmp_size + (direct ? 0 : count));
+        scratch = buffer.get();
+    }
+    word_t* num = scratch;
+    word_t* den = num + size;
+    word_t* tmp = den + dn;
+    word_t* q = (direct ? quo.words : tmp + tmp_size);
+    wregister nnum{num, size, 0, false};
+    wregister nden{den, dn, 0, false};
+    div_normalize(left, shift, nnum);
+    div_normalize(right, shift, nden);
+
+    // Upper dn words of num are less than den.
+    for (index_t offset = count; offset > 0;)
+    {
+        const index_t block = (offset - 1) % dn + 1;
+        offset -= block;
+        if ((inverse != nullptr) && (block == dn) && (dn >= AP_BARRETT_THRESHOLD))
+        {
+            div_barrett(num + offset, rregister(nden), inverse, q + offset, tmp);
         }
-        if (j < quo.capacity)
+        else
         {
-            quo.words[j] = static_cast<word_t>(q);
+            div_bz(num + offset, block, rregister(nden), q + offset, tmp);
         }
     }
-    quo.size = AP_MIN(size_diff, quo.capacity);
-    nleft.size = i;
-    if (nleft.size != 0)
+
+    quo.size = AP_MIN(count, quo.capacity);
+    if (!direct && (quo.size != 0))
+    {
+        std::memcpy(quo.words, q, quo.size * word_traits::bytes);
+    }
+    div_denormalize(rregister{num, dn, dn, false}, shift, rem);
+}
+
+index_t asm_div_bz_scratch(index_t left_size, index_t right_size)
+{
+    return div_long_scratch(left_size, right_size, false);
+}
+
+void asm_div_bz(const rregister& left, const rregister& right, wregister& quo, wregister& rem, word_t* scratch)
+{
+    div_long(left, right, nullptr, quo, rem, scratch);
+}
+
+index_t asm_invert_scratch(index_t in_size)
+{
+    return in_size + div_invert_scratch(in_size);
+}
+
+void asm_invert(const rregister& in, wregister& out, word_t* scratch)
+{
+    const index_t n = in.size;
+    auto buffer = array_null<word_t>();
+    if (scratch == nullptr)
+    {
+        buffer = array_alloc<word_t>(asm_invert_scratch(n));
+        scratch = buffer.get();
+    }
+    wregister den{scratch, n, 0, false};
+    div_normalize(in, div_shift(in), den);
+    div_invert(rregister(den), out.words, den.words + n);
+    out.size = n;
+}
+
+index_t asm_div_inv_scratch(index_t left_size, index_t right_size)
+{
+    return div_long_scratch(left_size, right_size, true);
+}
+
+void asm_div_inv(const rregister& left, const rregister& right, const rregister& inverse, wregister& quo,
+                 wregister& rem, word_t* scratch)
+{
+    div_long(left, right, inverse.words, quo, rem, scratch);
+}
+
+index_t asm_div_newton_scratch(index_t left_size, index_t right_size)
+{
+    return right_size + AP_MAX(asm_invert_scratch(right_size), div_long_scratch(left_size, right_size, true));
+}
+
+void asm_div_newton(const rregister& left, const rregister& right, wregister& quo, wregister& rem, word_t* scratch)
+{
+    auto buffer = array_null<word_t>();
+    if (scratch == nullptr)
     {
-        asm_div_short(rregister(nleft), normalizer, rem, nright);
+        buffer = array_alloc<word_t>(right.size);
     }
+    wregister inverse{(scratch != nullptr) ? scratch : buffer.get(), right.size, 0, false};
+    word_t* rest = ((scratch != nullptr) ? scratch + right.size : nullptr);
+    asm_invert(right, inverse, rest);
+    div_long(left, right, inverse.words, quo, rem, rest);
 }
 
 using bit_op_t = word_t (*)(word_t, word_t);
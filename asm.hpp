@@ -134,6 +134,148 @@ ap_linkage dword_t asm_mul_short(const rregister& left, dword_t right, wregister
 // left.size in [1, out.capacity].
 ap_linkage dword_t asm_mul(const rregister& left, const rregister& right, wregister& out);
 
+// Scratch words required by asm_mul_karatsuba.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_mul_karatsuba_scratch(index_t left_size, index_t right_size);
+
+// Word-wise wrapping long-long multiplication left by right, Karatsuba algorithm.
+// Operands shorter than AP_KARATSUBA_THRESHOLD words are multiplied with asm_mul.
+// Squares, left and right referring to the same words, are computed with fewer products.
+// out.words may refer to the words of left or right.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(left.size + right.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (left * right).
+// Preconditions:
+// scratch is null or holds at least asm_mul_karatsuba_scratch(left.size, right.size) words.
+// right.size in [1, left.size].
+// left.size in [1, out.capacity].
+ap_linkage dword_t asm_mul_karatsuba(const rregister& left, const rregister& right, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_mul_toom.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_mul_toom_scratch(index_t left_size, index_t right_size);
+
+// Word-wise wrapping long-long multiplication left by right, Toom-Cook algorithm.
+// Balanced operands are multiplied with Toom-3 or Toom-4, unbalanced ones with Toom-32 or Toom-42.
+// Operands shorter than AP_TOOM3_THRESHOLD words are multiplied with asm_mul_karatsuba.
+// Squares, left and right referring to the same words, are computed with fewer products.
+// out.words may refer to the words of left or right.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(left.size + right.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (left * right).
+// Preconditions:
+// scratch is null or holds at least asm_mul_toom_scratch(left.size, right.size) words.
+// right.size in [1, left.size].
+// left.size in [1, out.capacity].
+ap_linkage dword_t asm_mul_toom(const rregister& left, const rregister& right, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_mul_ntt.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_mul_ntt_scratch(index_t left_size, index_t right_size);
+
+// Word-wise wrapping long-long multiplication left by right, number theoretic transform.
+// Operands are split into 32-bit pieces regardless of the word size.
+// Convolutions modulo three 32-bit primes are recombined with the Chinese remainder theorem.
+// Products longer than the transform can hold exactly are multiplied with asm_mul_ssa.
+// Squares, left and right referring to the same words, are computed with fewer products.
+// out.words may refer to the words of left or right.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(left.size + right.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (left * right).
+// Preconditions:
+// scratch is null or holds at least asm_mul_ntt_scratch(left.size, right.size) words.
+// right.size in [1, left.size].
+// left.size in [1, out.capacity].
+ap_linkage dword_t asm_mul_ntt(const rregister& left, const rregister& right, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_mul_ssa.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_mul_ssa_scratch(index_t left_size, index_t right_size);
+
+// Word-wise wrapping long-long multiplication left by right, Schoenhage-Strassen algorithm.
+// Operands are split into pieces, their cyclic convolution is computed with a transform modulo 2^N + 1.
+// Twiddle factors are powers of 2, pointwise products are multiplied with asm_mul_toom or asm_mul_ntt.
+// Squares, left and right referring to the same words, are computed with fewer products.
+// out.words may refer to the words of left or right.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(left.size + right.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (left * right).
+// Preconditions:
+// scratch is null or holds at least asm_mul_ssa_scratch(left.size, right.size) words.
+// right.size in [1, left.size].
+// left.size in [1, out.capacity].
+ap_linkage dword_t asm_mul_ssa(const rregister& left, const rregister& right, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_sqr.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_sqr_scratch(index_t in_size);
+
+// Word-wise wrapping squaring of in.
+// Each cross product is computed once and doubled, squares of words are added on the diagonal.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(2 * in.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (in * in).
+// Preconditions:
+// scratch is null or holds at least asm_sqr_scratch(in.size) words.
+// in.size in [1, out.capacity].
+ap_linkage dword_t asm_sqr(const rregister& in, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_sqr_karatsuba.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_sqr_karatsuba_scratch(index_t in_size);
+
+// Word-wise wrapping squaring of in, Karatsuba algorithm.
+// Operands shorter than AP_KARATSUBA_THRESHOLD words are squared with asm_sqr.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(2 * in.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (in * in).
+// Preconditions:
+// scratch is null or holds at least asm_sqr_karatsuba_scratch(in.size) words.
+// in.size in [1, out.capacity].
+ap_linkage dword_t asm_sqr_karatsuba(const rregister& in, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_sqr_toom.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_sqr_toom_scratch(index_t in_size);
+
+// Word-wise wrapping squaring of in, Toom-3 or Toom-4 algorithm.
+// Operands shorter than AP_TOOM3_THRESHOLD words are squared with asm_sqr_karatsuba.
+// Nothing is allocated, unless scratch is null.
+// Return: Non-zero if the result does not fit into out.capacity words.
+// Change:
+// out.size = AP_MIN(2 * in.size, out.capacity).
+// out.words contains untrimmed wrapped two's complement pattern of (in * in).
+// Preconditions:
+// scratch is null or holds at least asm_sqr_toom_scratch(in.size) words.
+// in.size in [1, out.capacity].
+ap_linkage dword_t asm_sqr_toom(const rregister& in, wregister& out, word_t* scratch = nullptr);
+
 // Long-short division left by right.
 // Return: None.
 // Change:
@@ -146,7 +288,25 @@ ap_linkage dword_t asm_mul(const rregister& left, const rregister& right, wregis
 // left.size in [1, out.capacity].
 ap_linkage void asm_div_short(const rregister& left, dword_t right, wregister& quo, wregister& rem);
 
+// Long-short exact division left by right.
+// Return: None.
+// Change:
+// out.size = left.size.
+// out.words contains untrimmed two's complement pattern of (left / right).
+// Preconditions:
+// right is odd.
+// left is a multiple of right.
+// left.size in [0, out.capacity].
+ap_linkage void asm_divexact_short(const rregister& left, word_t right, wregister& out);
+
+// Scratch words required by asm_div.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_div_scratch(index_t left_size, index_t right_size);
+
 // Long-long division left by right.
+// Nothing is allocated, unless scratch is null.
 // Return: None.
 // Change:
 // quo.size = left.size + 1 - right.size.
@@ -154,10 +314,100 @@ ap_linkage void asm_div_short(const rregister& left, dword_t right, wregister& q
 // rem.size = right.size.
 // rem.words contains untrimmed two's complement pattern of (left % right).
 // Preconditions:
+// scratch is null or holds at least asm_div_scratch(left.size, right.size) words.
 // rem.capacity >= right.size.
 // right.size in [2, left.size].
 // left.size in [2, quo.capacity].
-ap_linkage void asm_div(const rregister& left, const rregister& right, wregister& quo, wregister& rem);
+ap_linkage void asm_div(const rregister& left, const rregister& right, wregister& quo, wregister& rem, word_t* scratch = nullptr);
+
+// Scratch words required by asm_div_bz.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_div_bz_scratch(index_t left_size, index_t right_size);
+
+// Long-long division left by right, Burnikel-Ziegler algorithm.
+// Quotient is computed by recursive halving, most of the work is done by multiplication.
+// Quotients shorter than AP_BZ_THRESHOLD words are computed with the schoolbook algorithm.
+// Nothing is allocated, unless scratch is null.
+// Return: None.
+// Change:
+// quo.size = AP_MIN(left.size + 1 - right.size, quo.capacity).
+// quo.words contains untrimmed two's complement pattern of (left / right).
+// rem.size = right.size.
+// rem.words contains untrimmed two's complement pattern of (left % right).
+// Preconditions:
+// scratch is null or holds at least asm_div_bz_scratch(left.size, right.size) words.
+// Trimmed right.
+// rem.capacity >= right.size.
+// right.size in [2, left.size].
+ap_linkage void asm_div_bz(const rregister& left, const rregister& right, wregister& quo, wregister& rem, word_t* scratch = nullptr);
+
+// Scratch words required by asm_invert.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_invert_scratch(index_t in_size);
+
+// Reciprocal of in, normalized by the left shift which sets its most significant bit.
+// Newton iteration doubles the precision of the reciprocal of upper words of in, short reciprocals are computed by
+// division, see asm_div_bz.
+// Nothing is allocated, unless scratch is null.
+// Return: None.
+// Change:
+// out.size = in.size.
+// out.words contains floor((base^(2 * in.size) - 1) / (in << shift)) - base^in.size.
+// Preconditions:
+// scratch is null or holds at least asm_invert_scratch(in.size) words.
+// Trimmed in.
+// in.size in [1, out.capacity].
+ap_linkage void asm_invert(const rregister& in, wregister& out, word_t* scratch = nullptr);
+
+// Scratch words required by asm_div_inv.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_div_inv_scratch(index_t left_size, index_t right_size);
+
+// Long-long division left by right with reciprocal of right, Barrett's algorithm.
+// Reciprocal is reused, division by the same right costs two multiplications per right.size words of quotient.
+// Divisors shorter than AP_BARRETT_THRESHOLD words do not need reciprocal, see asm_div_bz.
+// Nothing is allocated, unless scratch is null.
+// Return: None.
+// Change:
+// quo.size = AP_MIN(left.size + 1 - right.size, quo.capacity).
+// quo.words contains untrimmed two's complement pattern of (left / right).
+// rem.size = right.size.
+// rem.words contains untrimmed two's complement pattern of (left % right).
+// Preconditions:
+// Trimmed right.
+// inverse is out of asm_invert(right), its words may be null if right.size < AP_BARRETT_THRESHOLD.
+// scratch is null or holds at least asm_div_inv_scratch(left.size, right.size) words.
+// rem.capacity >= right.size.
+// right.size in [2, left.size].
+ap_linkage void asm_div_inv(const rregister& left, const rregister& right, const rregister& inverse, wregister& quo,
+                            wregister& rem, word_t* scratch);
+
+// Scratch words required by asm_div_newton.
+// Return: Count of words.
+// Change: None.
+// Preconditions: None.
+ap_linkage index_t asm_div_newton_scratch(index_t left_size, index_t right_size);
+
+// Long-long division left by right, reciprocal of right is computed by asm_invert, then asm_div_inv is used.
+// Nothing is allocated, unless scratch is null.
+// Return: None.
+// Change:
+// quo.size = AP_MIN(left.size + 1 - right.size, quo.capacity).
+// quo.words contains untrimmed two's complement pattern of (left / right).
+// rem.size = right.size.
+// rem.words contains untrimmed two's complement pattern of (left % right).
+// Preconditions:
+// scratch is null or holds at least asm_div_newton_scratch(left.size, right.size) words.
+// Trimmed right.
+// rem.capacity >= right.size.
+// right.size in [2, left.size].
+ap_linkage void asm_div_newton(const rregister& left, const rregister& right, wregister& quo, wregister& rem, word_t* scratch = nullptr);
 
 // Word-wise OR operation.
 // Return: None.
@@ -18,6 +18,35 @@
 #define AP_SIZE decltype(sizeof(0))
 #endif
 
+// Storage.
+
+// Integers of at most this many bits keep their words inline instead of allocating them on the heap.
+#ifndef AP_INLINE_BITWIDTH
+#define AP_INLINE_BITWIDTH 1024
+#endif
+
+// Allocator of word arrays: 0 is malloc and free, 1 is a thread-local pool which keeps freed arrays by size for reuse.
+#ifndef AP_ALLOCATOR
+#define AP_ALLOCATOR 0
+#endif
+
+// Pool keeps arrays of at most this many bytes, longer ones are allocated with malloc. Power of two.
+#ifndef AP_POOL_MAX_SIZE
+#define AP_POOL_MAX_SIZE 65536
+#endif
+
+// Pool keeps at most this many freed arrays of each size per thread, the rest is freed.
+#ifndef AP_POOL_DEPTH
+#define AP_POOL_DEPTH 64
+#endif
+
+// Strings.
+
+// Parsing accepts letters of either case when the digit alphabet has only one of them, e.g. "0xff" with "0123456789ABCDEF".
+#ifndef AP_CASELESS_DIGITS
+#define AP_CASELESS_DIGITS 0
+#endif
+
 // Linkage.
 
 #ifndef AP_USE_SOURCES
@@ -43,4 +72,71 @@ static_assert(AP_WORD_SIZE * 2 == AP_DWORD_SIZE, "AP: AP_DWORD_SIZE must be twic
 static_assert(sizeof(AP_WORD) == AP_WORD_SIZE, "AP: sizeof(AP_WORD) does not match AP_WORD_SIZE");
 static_assert(sizeof(AP_DWORD) == AP_DWORD_SIZE, "AP: sizeof(AP_DWORD) does not match AP_DWORD_SIZE");
 
+// Algorithm thresholds, in words.
+
+// Multiplication switches from schoolbook to Karatsuba when the shorter operand is at least that long.
+#ifndef AP_KARATSUBA_THRESHOLD
+#define AP_KARATSUBA_THRESHOLD 32
+#endif
+
+// Multiplication switches from Karatsuba to Toom-3 (and its unbalanced variants) when the shorter operand is at least that long.
+#ifndef AP_TOOM3_THRESHOLD
+#define AP_TOOM3_THRESHOLD 128
+#endif
+
+// Multiplication of balanced operands switches from Toom-3 to Toom-4 when the shorter operand is at least that long.
+#ifndef AP_TOOM4_THRESHOLD
+#define AP_TOOM4_THRESHOLD 384
+#endif
+
+// Multiplication switches from Toom-Cook to number theoretic transform when the shorter operand is at least that long.
+#ifndef AP_NTT_THRESHOLD
+#define AP_NTT_THRESHOLD 16384
+#endif
+
+// Multiplication switches from number theoretic transform to Schoenhage-Strassen when the shorter operand is at least that
+// long. Default is 2^30 bits, the longest balanced operands number theoretic transform multiplies exactly.
+#ifndef AP_SSA_THRESHOLD
+#define AP_SSA_THRESHOLD (134217728 / AP_WORD_SIZE)
+#endif
+
+// Division switches from schoolbook to Burnikel-Ziegler when the divisor is at least that long.
+#ifndef AP_BZ_THRESHOLD
+#define AP_BZ_THRESHOLD 32
+#endif
+
+// Division with precomputed reciprocal switches from Burnikel-Ziegler to Barrett when the divisor is at least that long.
+#ifndef AP_BARRETT_THRESHOLD
+#define AP_BARRETT_THRESHOLD 512
+#endif
+
+// Division and reciprocal switch from Burnikel-Ziegler to Newton iteration when the divisor is at least that long.
+#ifndef AP_NEWTON_THRESHOLD
+#define AP_NEWTON_THRESHOLD 16384
+#endif
+
+// Conversion to string switches from word-sized chunks to divide-and-conquer when the value is at least that long.
+#ifndef AP_TSTR_THRESHOLD
+#define AP_TSTR_THRESHOLD 32
+#endif
+
+// Conversion from string switches from word-sized chunks to divide-and-conquer when the value is at least that long.
+#ifndef AP_FSTR_THRESHOLD
+#define AP_FSTR_THRESHOLD 256
+#endif
+
+static_assert(AP_KARATSUBA_THRESHOLD >= 2, "AP: AP_KARATSUBA_THRESHOLD must be at least 2");
+static_assert(AP_TOOM3_THRESHOLD >= AP_KARATSUBA_THRESHOLD, "AP: AP_TOOM3_THRESHOLD must not be less than AP_KARATSUBA_THRESHOLD");
+static_assert(AP_TOOM4_THRESHOLD >= AP_TOOM3_THRESHOLD, "AP: AP_TOOM4_THRESHOLD must not be less than AP_TOOM3_THRESHOLD");
+static_assert(AP_NTT_THRESHOLD >= AP_TOOM3_THRESHOLD, "AP: AP_NTT_THRESHOLD must not be less than AP_TOOM3_THRESHOLD");
+static_assert(AP_SSA_THRESHOLD >= AP_NTT_THRESHOLD, "AP: AP_SSA_THRESHOLD must not be less than AP_NTT_THRESHOLD");
+static_assert(AP_BZ_THRESHOLD >= 2, "AP: AP_BZ_THRESHOLD must be at least 2");
+static_assert(AP_BARRETT_THRESHOLD >= 2, "AP: AP_BARRETT_THRESHOLD must be at least 2");
+static_assert(AP_NEWTON_THRESHOLD >= AP_BZ_THRESHOLD, "AP: AP_NEWTON_THRESHOLD must not be less than AP_BZ_THRESHOLD");
+static_assert(AP_NEWTON_THRESHOLD >= AP_BARRETT_THRESHOLD, "AP: AP_NEWTON_THRESHOLD must not be less than AP_BARRETT_THRESHOLD");
+static_assert(AP_TSTR_THRESHOLD >= 2, "AP: AP_TSTR_THRESHOLD must be at least 2");
+static_assert(AP_FSTR_THRESHOLD >= 2, "AP: AP_FSTR_THRESHOLD must be at least 2");
+static_assert((AP_ALLOCATOR == 0) || (AP_ALLOCATOR == 1), "AP: AP_ALLOCATOR must be 0 or 1");
+static_assert((AP_POOL_MAX_SIZE >= 16) && ((AP_POOL_MAX_SIZE & (AP_POOL_MAX_SIZE - 1)) == 0), "AP: AP_POOL_MAX_SIZE must be a power of two, at least 16");
+
 #endif
@@ -0,0 +1,153 @@
+#ifndef DEOHAYER_AP_DIGIT_GENERATOR_HPP
+#define DEOHAYER_AP_DIGIT_GENERATOR_HPP
+
+#include "integer_api.hpp"
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ap
+{
+namespace library
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// digit_generator class, converts value to string chunk by chunk
+
+// Chunks are produced most significant first, concatenated they are the same as str() of the value. Long values are split
+// in halves by a power of base, the less significant halves wait in a stack while the more significant ones are converted.
+// So memory is about the size of the value, the first chunk is ready after a few divisions instead of the whole conversion.
+// Usage:
+// for (digit_generator gen = value.str_generator(); gen.next();)
+// {
+//     out.write(gen.data(), gen.size());
+// }
+class digit_generator
+{
+    struct part
+    {
+        array<word_t> words;
+        index_t size;
+        // Number of digits the part takes, leading zeros included. 0 for the most significant part.
+        index_t pad;
+    };
+
+    std::vector<part> parts;
+    std::string chunk;
+    index_t base;
+    const char* digits;
+    bool sign;
+    bool prefix;
+
+    static part make_part(index_t capacity, index_t pad)
+    {
+        return part{array_alloc<word_t>(AP_MAX(capacity, index_t{1})), 0, pad};
+    }
+
+    // Convert the short part, the most significant one gets sign and prefix.
+    void convert(const part& top)
+    {
+        rregister in{top.words.get(), top.size, top.size, this->sign};
+        this->chunk.clear();
+        if (top.pad == 0)
+        {
+            if (this->sign)
+            {
+                sinteger_tstr(in, this->chunk, this->base, this->digits, this->prefix);
+            }
+            else
+            {
+                uinteger_tstr(in, this->chunk, this->base, this->digits, this->prefix);
+            }
+            return;
+        }
+        index_t count = 0;
+        if (top.size != 0)
+        {
+            this->chunk.resize(est_tstr(top.size, this->base));
+            count = uinteger_tchars(in, &this->chunk[0], this->chunk.size(), this->base, this->digits);
+        }
+        this->chunk.resize(count);
+        if (count < top.pad)
+        {
+            this->chunk.insert(0, top.pad - count, this->digits[0]);
+        }
+    }
+
+public:
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // ctor
+
+    // Value is copied, in may change after the generator is created.
+    digit_generator(const rregister& in, index_t base, const char* digits, bool prefix = true)
+        : parts(),
+          chunk(),
+          base(base),
+          digits(digits),
+          sign(in.sign != 0),
+          prefix(prefix)
+    {
+        part top = make_part(in.size, 0);
+        top.size = in.size;
+        if (in.size != 0)
+        {
+            std::memcpy(top.words.get(), in.words, in.size * word_traits::bytes);
+        }
+        this->parts.push_back(std::move(top));
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // chunks
+
+    // Produce the next chunk.
+    // Return: false, if there are no more chunks.
+    bool next()
+    {
+        if (this->parts.empty())
+        {
+            this->chunk.clear();
+            return false;
+        }
+        while (this->parts.back().size >= AP_TSTR_THRESHOLD)
+        {
+            part top = std::move(this->parts.back());
+            this->parts.pop_back();
+            rregister in{top.words.get(), top.size, top.size, false};
+            part quo = make_part(top.size, 0);
+            part rem = make_part(top.size, 0);
+            wregister qreg{quo.words.get(), top.size, 0, false};
+            wregister rreg{rem.words.get(), top.size, 0, false};
+            rem.pad = uinteger_tstr_split(in, this->base, qreg, rreg);
+            quo.size = qreg.size;
+            rem.size = rreg.size;
+            // Leading zeros of a less significant part belong to the more significant one.
+            quo.pad = ((top.pad > rem.pad) ? top.pad - rem.pad : 0);
+            this->parts.push_back(std::move(rem));
+            this->parts.push_back(std::move(quo));
+        }
+        this->convert(this->parts.back());
+        this->parts.pop_back();
+        return true;
+    }
+
+    const char* data() const
+    {
+        return this->chunk.data();
+    }
+
+    index_t size() const
+    {
+        return this->chunk.size();
+    }
+
+    const std::string& get() const
+    {
+        return this->chunk;
+    }
+};
+
+} // namespace library
+} // namespace ap
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef DEOHAYER_AP_DIVISOR_HPP
+#define DEOHAYER_AP_DIVISOR_HPP
+
+#include "integer.hpp"
+#include <utility>
+
+namespace ap
+{
+namespace library
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// divisor class, represents invariant divisor with precomputed reciprocal
+
+// Results are the same as of operator/ and operator% of integer. Long divisors keep reciprocal, so division costs two
+// multiplications per divisor length of quotient, see asm_div_inv. Nothing is allocated once the scratch fits the dividend,
+// except the returned values.
+// Methods share the scratch, so the same divisor must not be used by several threads at once, use copies instead.
+template <index_t _Bitwidth, bool _Signed>
+class divisor
+{
+public:
+    using integer_t = integer<_Bitwidth, _Signed>;
+
+    template <typename _Integer>
+    using result_t = wider_int_t<_Integer, integer_t>;
+
+private:
+    integer_t value;
+    array<word_t> inverse;
+    mutable array<word_t> scratch;
+    mutable index_t scratch_size;
+
+    void setup()
+    {
+        rregister reg = this->value.handle.get_rregister();
+        if (reg.size >= AP_BARRETT_THRESHOLD)
+        {
+            this->inverse = array_alloc<word_t>(reg.size);
+            wregister out{this->inverse.get(), reg.size, 0, false};
+            asm_invert(reg, out);
+        }
+    }
+
+    // Reciprocal is computed for magnitude, it is useless if the magnitude changes in the result type.
+    template <typename _Result>
+    bool has_inverse() const
+    {
+        return (this->value.handle.get_size() >= 2) && (_Result::is_signed || !this->value.handle.get_sign());
+    }
+
+    template <typename _Result>
+    void divide(const _Result& left, _Result* quo, _Result* rem) const
+    {
+        if (!this->has_inverse<_Result>())
+        {
+            const _Result right(this->value);
+            if (quo != nullptr)
+            {
+                *quo = left / right;
+            }
+            if (rem != nullptr)
+            {
+                *rem = left % right;
+            }
+            return;
+        }
+
+        const index_t left_size = left.handle.get_size();
+        const index_t right_size = this->value.handle.get_size();
+        if (quo != nullptr)
+        {
+            quo->handle.reserve(est_quo(left_size, right_size) + 1);
+        }
+        if (rem != nullptr)
+        {
+            rem->handle.reserve(est_rem(left_size, right_size) + 1);
+        }
+
+        rregister lreg = left.handle.get_rregister();
+        rregister rreg = this->value.handle.get_rregister();
+        const index_t size = est_div_inv(lreg.size, rreg.size);
+        if (size > this->scratch_size)
+        {
+            this->scratch = array_alloc<word_t>(size);
+            this->scratch_size = size;
+        }
+
+        wregister none{nullptr, 0, 0, false};
+        wregister& qreg = ((quo != nullptr) ? quo->handle.get_wregister() : none);
+        wregister& rem_reg = ((rem != nullptr) ? rem->handle.get_wregister() : none);
+        qreg.sign = 0;
+        rem_reg.sign = 0;
+        rregister ireg{this->inverse.get(), rreg.size, rreg.size, false};
+        if (_Result::is_signed)
+        {
+            sinteger_div_inv(lreg, rreg, ireg, qreg, rem_reg, this->scratch.get());
+        }
+        else
+        {
+            uinteger_div_inv(lreg, rreg, ireg, qreg, rem_reg, this->scratch.get());
+        }
+    }
+
+    template <typename _Result, typename _Integer>
+    void divide(const _Integer& left, _Result* quo, _Result* rem) const
+    {
+        this->divide<_Result>(_Result(left), quo, rem);
+    }
+
+public:
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // ctor
+
+    explicit divisor(const integer_t& value)
+        : value(value),
+          inverse(array_null<word_t>()),
+          scratch(array_null<word_t>()),
+          scratch_size(0)
+    {
+        this->setup();
+    }
+
+    divisor(const divisor& other)
+        : value(other.value),
+          inverse(array_null<word_t>()),
+          scratch(array_null<word_t>()),
+          scratch_size(0)
+    {
+        if (other.inverse.get() != nullptr)
+        {
+            const index_t size = this->value.handle.get_size();
+            this->inverse = array_alloc<word_t>(size);
+            std::memcpy(this->inverse.get(), other.inverse.get(), size * word_traits::bytes);
+        }
+    }
+
+    divisor(divisor&& other) = default;
+
+    divisor& operator=(const divisor& other)
+    {
+        if (this != &other)
+        {
+            *this = divisor(other);
+        }
+        return *this;
+    }
+
+    divisor& operator=(divisor&& other) = default;
+
+    const integer_t& get() const
+    {
+        return this->value;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // division
+
+    template <typename _Integer, typename std::enable_if<bool(_Integer::valuewidth), bool>::type = false>
+    result_t<_Integer> quo(const _Integer& left) const
+    {
+        result_t<_Integer> result;
+        this->divide<result_t<_Integer>>(left, &result, nullptr);
+        return result;
+    }
+
+    template <typename _Integer, typename std::enable_if<bool(_Integer::valuewidth), bool>::type = false>
+    result_t<_Integer> rem(const _Integer& left) const
+    {
+        result_t<_Integer> result;
+        this->divide<result_t<_Integer>>(left, nullptr, &result);
+        return result;
+    }
+
+    // Quotient and remainder.
+    template <typename _Integer, typename std::enable_if<bool(_Integer::valuewidth), bool>::type = false>
+    std::pair<result_t<_Integer>, result_t<_Integer>> divmod(const _Integer& left) const
+    {
+        std::pair<result_t<_Integer>, result_t<_Integer>> result;
+        this->divide<result_t<_Integer>>(left, &result.first, &result.second);
+        return result;
+    }
+};
+
+} // namespace library
+} // namespace ap
+
+#endif
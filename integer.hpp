@@ -1,9 +1,12 @@
 #ifndef DEOHAYER_AP_INT_HPP
 #define DEOHAYER_AP_INT_HPP
 
+#include "digit_generator.hpp"
 #include "integer_api.hpp"
 #include "integer_handle.hpp"
 #include <iostream>
+#include <system_error>
+#include <utility>
 
 namespace ap
 {
@@ -39,23 +42,65 @@ constexpr bool is_same_v()
 template <typename _IntegerL, typename _IntegerR>
 using wider_int_t = typename wider_int<_IntegerL, _IntegerR, (index_t(_IntegerL::valuewidth) >= index_t(_IntegerR::valuewidth))>::type;
 
+template <index_t _Bitwidth, bool _Signed>
+class divisor;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Access to the get area of std::streambuf, it is protected
+
+struct streambuf_access : std::streambuf
+{
+    static const char* begin(std::streambuf& buf)
+    {
+        return (buf.*(&streambuf_access::gptr))();
+    }
+
+    static const char* end(std::streambuf& buf)
+    {
+        return (buf.*(&streambuf_access::egptr))();
+    }
+
+    static void bump(std::streambuf& buf, index_t count)
+    {
+        (buf.*(&streambuf_access::gbump))(static_cast<int>(count));
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Results of character conversion, same as of std::to_chars and std::from_chars
+
+struct to_chars_result
+{
+    char* ptr;
+    std::errc ec;
+};
+
+struct from_chars_result
+{
+    const char* ptr;
+    std::errc ec;
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // integer class, represents user-level API
 
-template <index_t _Bitwidth, bool _Signed>
+template <index_t _Bitwidth, bool _Signed, typename _Allocator = array_allocator<word_t>>
 class integer
 {
     // Currently support for reverse narrowing is not available.
-    static_assert(_Bitwidth > (sizeof(unsigned long long) * CHAR_BIT), "AP integer must be strictly greater than unsigned long long.");
+    static_assert((_Bitwidth == 0) || (_Bitwidth > (sizeof(unsigned long long) * CHAR_BIT)), "AP integer must be strictly greater than unsigned long long.");
 
 public:
     // Divided we fall.
-    template <index_t _BitwidthO, bool _SignedO>
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO>
     friend class integer;
 
+    template <index_t _BitwidthO, bool _SignedO>
+    friend class divisor;
+
 private:
     // Holds actual data.
-    using handle_t = integer_handle<_Bitwidth>;
+    using handle_t = integer_handle<_Bitwidth, _Allocator>;
     handle_t handle;
 
 private:
@@ -77,6 +122,8 @@ private:
     }
 
 public:
+    using allocator_type = _Allocator;
+
     enum : index_t
     {
         is_signed = _Signed,
@@ -91,6 +138,15 @@ public:
 
     integer() = default;
 
+    // Heap words are allocated with alloc, inline words ignore it. Copies and results of operations use the default
+    // allocator, assignment keeps the allocator of the target.
+    explicit integer(const allocator_type& alloc) : handle(alloc) {}
+
+    allocator_type get_allocator() const
+    {
+        return this->handle.get_allocator();
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // str
 
@@ -98,6 +154,7 @@ public:
     {
         fregister flags;
         size = ((size != 0) ? size : strlen(str));
+        this->handle.reserve(est_fstr(size, base) + 1);
         if (this->is_signed)
         {
             flags = sinteger_fstr(this->handle.get_wregister(), str, size, base, digits);
@@ -154,12 +211,155 @@ public:
         return this->str();
     }
 
+    // Same as str(), but the string is produced in chunks, see digit_generator.
+    digit_generator str_generator(index_t base = AP_DEFAULT_STR_BASE, const char* digits = AP_DEFAULT_STR) const
+    {
+        rregister r = this->handle.get_rregister();
+        r.sign = (this->is_signed ? r.sign : 0);
+        return digit_generator(r, base, digits);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // chars
+
+    // Same as std::to_chars: no prefix, "-" is written for negative values, value_too_large if [first, last) is too short.
+    // Nothing is allocated, unless the value is longer than AP_TSTR_THRESHOLD words and base is not a power of two.
+    to_chars_result to_chars(char* first, char* last, index_t base = AP_DEFAULT_STR_BASE, const char* digits = AP_DEFAULT_STR) const
+    {
+        const index_t capacity = index_t(last - first);
+        index_t count = 0;
+        rregister r = this->handle.get_rregister();
+        if (this->is_signed)
+        {
+            count = sinteger_tchars(r, first, capacity, base, digits);
+        }
+        else
+        {
+            count = uinteger_tchars(r, first, capacity, base, digits);
+        }
+        if (count > capacity)
+        {
+            return to_chars_result{last, std::errc::value_too_large};
+        }
+        return to_chars_result{first + count, std::errc()};
+    }
+
+    // Same as std::from_chars: no prefix, "-" is accepted by signed integers only, invalid_argument if [first, last) does
+    // not start with a digit, result_out_of_range if the value does not fit. The integer is unchanged on error.
+    from_chars_result from_chars(const char* first, const char* last, index_t base = AP_DEFAULT_STR_BASE, const char* digits = AP_DEFAULT_STR)
+    {
+        const index_t size = index_t(last - first);
+        index_t count = 0;
+        fregister flags;
+        integer result;
+        result.handle.reserve(est_fchars(first, size, base, digits) + 1);
+        wregister& out = result.handle.get_wregister();
+        if (this->is_signed)
+        {
+            count = sinteger_fchars(out, first, size, base, digits, flags);
+        }
+        else
+        {
+            count = uinteger_fchars(out, first, size, base, digits, flags);
+        }
+        if (count == 0)
+        {
+            return from_chars_result{first, std::errc::invalid_argument};
+        }
+        if (flags.has_any(fregister::overflow))
+        {
+            return from_chars_result{first + count, std::errc::result_out_of_range};
+        }
+        *this = std::move(result);
+        return from_chars_result{first + count, std::errc()};
+    }
+
+    // Read from buf up to the first symbol which is not a part of the integer, the symbol stays in buf. Sign and prefix are
+    // accepted the same way as by set(), digits are parsed right in the get area of buf.
+    // Return: false, if there are no digits.
+    bool read(std::streambuf& buf, index_t base = 0)
+    {
+        using traits = std::streambuf::traits_type;
+        traits::int_type symbol = buf.sgetc();
+        const bool negative = (symbol == '-');
+        if (negative || (symbol == '+'))
+        {
+            symbol = buf.snextc();
+        }
+        // Detectable bases are 2 ("0b", "0B"), 8 ("0"), 10 (default), 16 ("0x", "0X").
+        index_t detected_base = 10;
+        bool has_digits = false;
+        if (symbol == '0')
+        {
+            has_digits = true;
+            detected_base = 8;
+            symbol = buf.snextc();
+            if ((symbol == 'x') || (symbol == 'X'))
+            {
+                detected_base = 16;
+                symbol = buf.snextc();
+            }
+            else if ((symbol == 'b') || (symbol == 'B'))
+            {
+                detected_base = 2;
+                symbol = buf.snextc();
+            }
+        }
+        base = ((base != 0) ? base : detected_base);
+
+        integer<_Bitwidth, false, _Allocator> magnitude;
+        wregister& out = magnitude.handle.get_wregister();
+        fregister flags;
+        while (!traits::eq_int_type(symbol, traits::eof()))
+        {
+            const char* first = streambuf_access::begin(buf);
+            const char* last = streambuf_access::end(buf);
+            // Unbuffered streams have no get area, symbols are taken one by one.
+            const char single = traits::to_char_type(symbol);
+            if (first == last)
+            {
+                first = &single;
+                last = first + 1;
+            }
+            magnitude.handle.reserve(out.size + est_fchars(first, index_t(last - first), base, AP_DEFAULT_STR) + 1);
+            const index_t count = uinteger_fchars_append(out, first, index_t(last - first), base, AP_DEFAULT_STR, flags);
+            has_digits = (has_digits || (count != 0));
+            if (first == &single)
+            {
+                symbol = ((count != 0) ? buf.snextc() : symbol);
+            }
+            else
+            {
+                streambuf_access::bump(buf, count);
+                symbol = buf.sgetc();
+            }
+            if (first + count != last)
+            {
+                break;
+            }
+        }
+        *this = integer(negative ? -magnitude : magnitude);
+        return has_digits;
+    }
+
+    // Exact number of characters written by to_chars. Costs as much as to_chars.
+    index_t required_chars(index_t base = AP_DEFAULT_STR_BASE, const char* digits = AP_DEFAULT_STR) const
+    {
+        rregister r = this->handle.get_rregister();
+        if (this->is_signed)
+        {
+            return sinteger_tchars(r, nullptr, 0, base, digits);
+        }
+        return uinteger_tchars(r, nullptr, 0, base, digits);
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // basic
 
     template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
     integer(T val)
     {
+        this->handle.reserve(sizeof(T) / word_traits::bytes + 2);
         wregister& reg = this->handle.get_wregister();
         if (this->is_signed)
         {
@@ -177,7 +377,8 @@ public:
             if (std::is_signed<T>::value)
             {
                 sinteger_fbasic(reg, val);
-                sinteger_tou(this->handle.get_rregister(), reg);
+                this->handle.reserve(wordwidth);
+                sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
             }
             else
             {
@@ -218,18 +419,19 @@ public:
 
     integer& operator=(integer&& other) = default;
 
-    template <index_t _BitwidthO, bool _SignedO, typename std::enable_if<!((_Bitwidth - _Signed) < (_BitwidthO - _SignedO)), bool>::type = false>
-    integer(integer<_BitwidthO, _SignedO>&& other)
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO, typename std::enable_if<!((declared_bitwidth(_Bitwidth) - _Signed) < (declared_bitwidth(_BitwidthO) - _SignedO)), bool>::type = false>
+    integer(integer<_BitwidthO, _SignedO, _AllocatorO>&& other)
     {
         this->handle = std::move(other.handle);
         if (this->handle.get_sign() && !this->is_signed)
         {
+            this->handle.reserve(wordwidth);
             sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
         }
     }
 
-    template <index_t _BitwidthO, bool _SignedO, typename std::enable_if<((_Bitwidth - _Signed) < (_BitwidthO - _SignedO)), bool>::type = false>
-    explicit integer(integer<_BitwidthO, _SignedO>&& other)
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO, typename std::enable_if<((declared_bitwidth(_Bitwidth) - _Signed) < (declared_bitwidth(_BitwidthO) - _SignedO)), bool>::type = false>
+    explicit integer(integer<_BitwidthO, _SignedO, _AllocatorO>&& other)
     {
         index_t other_size = other.handle.get_size();
         this->handle = std::move(other.handle);
@@ -237,6 +439,7 @@ public:
         {
             if (((other_size > this->handle.get_capacity()) && this->handle.get_sign()))
             {
+                this->handle.reserve(wordwidth);
                 sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
             }
 
@@ -249,13 +452,14 @@ public:
         {
             if (this->handle.get_sign() && !this->is_signed)
             {
+                this->handle.reserve(wordwidth);
                 sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
             }
         }
     }
 
-    template <index_t _BitwidthO, bool _SignedO>
-    integer& operator=(integer<_BitwidthO, _SignedO>&& other)
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO>
+    integer& operator=(integer<_BitwidthO, _SignedO, _AllocatorO>&& other)
     {
         *this = integer(std::move(other));
         return *this;
@@ -268,18 +472,19 @@ public:
 
     integer& operator=(const integer& other) = default;
 
-    template <index_t _BitwidthO, bool _SignedO, typename std::enable_if<!((_Bitwidth - _Signed) < (_BitwidthO - _SignedO)), bool>::type = false>
-    integer(const integer<_BitwidthO, _SignedO>& other)
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO, typename std::enable_if<!((declared_bitwidth(_Bitwidth) - _Signed) < (declared_bitwidth(_BitwidthO) - _SignedO)), bool>::type = false>
+    integer(const integer<_BitwidthO, _SignedO, _AllocatorO>& other)
     {
         this->handle = other.handle;
         if (this->handle.get_sign() && !this->is_signed)
         {
+            this->handle.reserve(wordwidth);
             sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
         }
     }
 
-    template <index_t _BitwidthO, bool _SignedO, typename std::enable_if<((_Bitwidth - _Signed) < (_BitwidthO - _SignedO)), bool>::type = false>
-    explicit integer(const integer<_BitwidthO, _SignedO>& other)
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO, typename std::enable_if<((declared_bitwidth(_Bitwidth) - _Signed) < (declared_bitwidth(_BitwidthO) - _SignedO)), bool>::type = false>
+    explicit integer(const integer<_BitwidthO, _SignedO, _AllocatorO>& other)
     {
         index_t other_size = other.handle.get_size();
         this->handle = other.handle;
@@ -287,6 +492,7 @@ public:
         {
             if (((other_size > this->handle.get_capacity()) && this->handle.get_sign()))
             {
+                this->handle.reserve(wordwidth);
                 sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
             }
 
@@ -299,13 +505,14 @@ public:
         {
             if (this->handle.get_sign() && !this->is_signed)
             {
+                this->handle.reserve(wordwidth);
                 sinteger_tou(this->handle.get_rregister(), this->handle.get_wregister());
             }
         }
     }
 
-    template <index_t _BitwidthO, bool _SignedO>
-    integer& operator=(const integer<_BitwidthO, _SignedO>& other)
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO>
+    integer& operator=(const integer<_BitwidthO, _SignedO, _AllocatorO>& other)
     {
         *this = integer(other);
         return *this;
@@ -384,7 +591,7 @@ public:
     {
         if (_Signed != bool(other.is_signed))
         {
-            if (_Bitwidth > (other.valuewidth))
+            if (declared_bitwidth(_Bitwidth) > (other.valuewidth))
             {
                 return this->cmp(integer(other));
             }
@@ -409,46 +616,81 @@ public:
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // ordinary binary operators
 
-#define AP_BINARY_OPERATOR(name, op, fhandler)                                                      \
-    template <typename T, typename std::enable_if<bool(T::valuewidth), bool>::type = false>         \
-    wider_int_t<integer<_Bitwidth, _Signed>, T> op(const T& other) const                            \
-    {                                                                                               \
-        wider_int_t<integer<_Bitwidth, _Signed>, T> result;                                         \
-        this->dispatch_binary_operation<uinteger_##name, sinteger_##name, fhandler>(other, result); \
-        return result;                                                                              \
-    }                                                                                               \
-                                                                                                    \
-    template <typename T, typename std::enable_if<bool(T::valuewidth), bool>::type = false>         \
-    integer& op## = (const T& other)                                                                \
-    {                                                                                               \
-        this->dispatch_binary_operation<uinteger_##name, sinteger_##name, fhandler>(other, *this);  \
-        return *this;                                                                               \
-    }                                                                                               \
-                                                                                                    \
-    template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>  \
-    integer op(const T& other) const                                                                \
-    {                                                                                               \
-        return this->op(integer(other));                                                            \
-    }                                                                                               \
-                                                                                                    \
-    template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>  \
-    integer& op## = (const T& other)                                                                \
-    {                                                                                               \
-        return this->op## = (integer(other));                                                       \
-    }
-
-    AP_BINARY_OPERATOR(add, operator+, fregister_handler_none)
-    AP_BINARY_OPERATOR(sub, operator-, fregister_handler_none)
-    AP_BINARY_OPERATOR(mul, operator*, fregister_handler_none)
-    AP_BINARY_OPERATOR(quo, operator/, fregister_handler_div)
-    AP_BINARY_OPERATOR(rem, operator%, fregister_handler_div)
-    AP_BINARY_OPERATOR(and, operator&, fregister_handler_none)
-    AP_BINARY_OPERATOR(or, operator|, fregister_handler_none)
-    AP_BINARY_OPERATOR(xor, operator^, fregister_handler_none)
+#define AP_BINARY_OPERATOR(name, op, fhandler, est)                                                      \
+    template <typename T, typename std::enable_if<bool(T::valuewidth), bool>::type = false>              \
+    wider_int_t<integer, T> op(const T& other) const                                                     \
+    {                                                                                                    \
+        wider_int_t<integer, T> result;                                                                  \
+        this->dispatch_binary_operation<uinteger_##name, sinteger_##name, fhandler, est>(other, result); \
+        return result;                                                                                   \
+    }                                                                                                    \
+                                                                                                         \
+    template <typename T, typename std::enable_if<bool(T::valuewidth), bool>::type = false>              \
+    integer& op## = (const T& other)                                                                     \
+    {                                                                                                    \
+        this->dispatch_binary_operation<uinteger_##name, sinteger_##name, fhandler, est>(other, *this);  \
+        return *this;                                                                                    \
+    }                                                                                                    \
+                                                                                                         \
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>       \
+    integer op(const T& other) const                                                                     \
+    {                                                                                                    \
+        return this->op(integer(other));                                                                 \
+    }                                                                                                    \
+                                                                                                         \
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>       \
+    integer& op## = (const T& other)                                                                     \
+    {                                                                                                    \
+        return this->op## = (integer(other));                                                            \
+    }
+
+    AP_BINARY_OPERATOR(add, operator+, fregister_handler_none, est_add)
+    AP_BINARY_OPERATOR(sub, operator-, fregister_handler_none, est_sub)
+    AP_BINARY_OPERATOR(mul, operator*, fregister_handler_none, est_mul)
+    AP_BINARY_OPERATOR(quo, operator/, fregister_handler_div, est_quo)
+    AP_BINARY_OPERATOR(rem, operator%, fregister_handler_div, est_rem)
+    AP_BINARY_OPERATOR(and, operator&, fregister_handler_none, est_bit)
+    AP_BINARY_OPERATOR(or, operator|, fregister_handler_none, est_bit)
+    AP_BINARY_OPERATOR(xor, operator^, fregister_handler_none, est_bit)
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // division
+
+    // Quotient and remainder, same as operator/ and operator%, but the division is done once.
+    template <typename T, typename std::enable_if<bool(T::valuewidth), bool>::type = false>
+    std::pair<wider_int_t<integer, T>, wider_int_t<integer, T>> divmod(const T& other) const
+    {
+        std::pair<wider_int_t<integer, T>, wider_int_t<integer, T>> result;
+        this->dispatch_div_operation(other, result.first, result.second);
+        return result;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+    std::pair<integer, integer> divmod(const T& other) const
+    {
+        return this->divmod(integer(other));
+    }
+
+    // Same as divmod, results are converted to the types of quo and rem. quo and rem must be different objects.
+    template <typename T, index_t _BitwidthQ, bool _SignedQ, typename _AllocatorQ, index_t _BitwidthR, bool _SignedR, typename _AllocatorR,
+              typename std::enable_if<bool(T::valuewidth), bool>::type = false>
+    void divmod_into(const T& other, integer<_BitwidthQ, _SignedQ, _AllocatorQ>& quo, integer<_BitwidthR, _SignedR, _AllocatorR>& rem) const
+    {
+        this->dispatch_div_operation(other, quo, rem);
+    }
+
+    template <typename T, index_t _BitwidthQ, bool _SignedQ, typename _AllocatorQ, index_t _BitwidthR, bool _SignedR, typename _AllocatorR,
+              typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+    void divmod_into(const T& other, integer<_BitwidthQ, _SignedQ, _AllocatorQ>& quo, integer<_BitwidthR, _SignedR, _AllocatorR>& rem) const
+    {
+        this->divmod_into(integer(other), quo, rem);
+    }
 
     integer operator~() const
     {
         integer result;
+        // Unsigned result has all ones above the value, signed one is at most one word longer.
+        result.handle.reserve(_Signed ? this->handle.get_size() + 2 : index_t(wordwidth));
         if (_Signed)
         {
             sinteger_not(this->handle.get_rregister(), result.handle.get_wregister());
@@ -500,6 +742,7 @@ public:
             }
             else
             {
+                result.handle.reserve(wordwidth);
                 reg.sign = 1;
                 sinteger_tou(rregister(reg), reg);
             }
@@ -515,6 +758,7 @@ public:
     integer operator>>(unsigned long long int shift) const
     {
         integer result;
+        result.handle.reserve(this->handle.get_size() + 1);
         if (_Signed)
         {
             sinteger_rsh(this->handle.get_rregister(), shift, result.handle.get_wregister());
@@ -542,6 +786,8 @@ public:
     integer operator<<(unsigned long long int shift) const
     {
         integer result;
+        // Everything is shifted out at bitwidth.
+        result.handle.reserve((shift < bitwidth) ? est_lsh(this->handle.get_size(), shift) + 1 : 1);
         if (_Signed)
         {
             sinteger_lsh(this->handle.get_rregister(), shift, result.handle.get_wregister());
@@ -562,11 +808,19 @@ public:
 private:
     using binary_operation = fregister (*)(rregister, rregister, wregister&);
     using fregister_handler = void (*)(fregister);
+    using size_estimator = index_t (*)(index_t, index_t);
+
+    // Result may be this or other, so it grows before the registers are taken. One more word keeps its msb clear.
+    template <size_estimator est, index_t _BitwidthR, bool _SignedR, typename _AllocatorR>
+    static void reserve_result(index_t left_size, index_t right_size, integer<_BitwidthR, _SignedR, _AllocatorR>& result)
+    {
+        result.handle.reserve(est(left_size, right_size) + 1);
+    }
 
-    template <binary_operation uop, binary_operation sop, fregister_handler h,
-              index_t _BitwidthO, bool _SignedO,
-              index_t _BitwidthR, bool _SignedR>
-    void dispatch_binary_operation(const integer<_BitwidthO, _SignedO>& other, integer<_BitwidthR, _SignedR>& result) const
+    template <binary_operation uop, binary_operation sop, fregister_handler h, size_estimator est,
+              index_t _BitwidthO, bool _SignedO, typename _AllocatorO,
+              index_t _BitwidthR, bool _SignedR, typename _AllocatorR>
+    void dispatch_binary_operation(const integer<_BitwidthO, _SignedO, _AllocatorO>& other, integer<_BitwidthR, _SignedR, _AllocatorR>& result) const
     {
         rregister left;
         rregister right;
@@ -574,28 +828,39 @@ private:
 
         if (_SignedO == _Signed)
         {
+            reserve_result<est>(this->handle.get_size(), other.handle.get_size(), result);
             left = this->handle.get_rregister();
             right = other.handle.get_rregister();
             wregister& out = result.handle.get_wregister();
             binary_operation op = (result.is_signed ? sop : uop);
             out.sign = 0;
             flags = op(left, right, out);
+            if (!result.is_signed && flags.has_any(fregister::overflow))
+            {
+                result.handle.extend_wrapped();
+            }
         }
         else
         {
             wregister& out = result.handle.get_wregister();
-            if ((_BitwidthO - _SignedO) > (_Bitwidth - _Signed))
+            if ((declared_bitwidth(_BitwidthO) - _SignedO) > (declared_bitwidth(_Bitwidth) - _Signed))
             {
-                integer<_BitwidthO, _SignedO> nleft{*this};
+                integer<_BitwidthO, _SignedO, _AllocatorO> nleft{*this};
+                reserve_result<est>(nleft.handle.get_size(), other.handle.get_size(), result);
                 left = nleft.handle.get_rregister();
                 right = other.handle.get_rregister();
                 binary_operation op = (_SignedO ? sop : uop);
                 out.sign = 0;
                 flags = op(left, right, out);
+                if (!_SignedO && !result.is_signed && flags.has_any(fregister::overflow))
+                {
+                    result.handle.extend_wrapped();
+                }
                 if (result.is_signed != _SignedO)
                 {
                     if (_SignedO)
                     {
+                        result.handle.reserve(out.sign ? index_t(result.wordwidth) : 0);
                         sinteger_tou(rregister(out), out);
                     }
                     else
@@ -606,16 +871,22 @@ private:
             }
             else
             {
-                integer<_Bitwidth, _Signed> nright{other};
+                integer<_Bitwidth, _Signed, _Allocator> nright{other};
+                reserve_result<est>(this->handle.get_size(), nright.handle.get_size(), result);
                 left = this->handle.get_rregister();
                 right = nright.handle.get_rregister();
                 binary_operation op = (_Signed ? sop : uop);
                 out.sign = 0;
                 flags = op(left, right, out);
+                if (!_Signed && !result.is_signed && flags.has_any(fregister::overflow))
+                {
+                    result.handle.extend_wrapped();
+                }
                 if (result.is_signed != _Signed)
                 {
                     if (_Signed)
                     {
+                        result.handle.reserve(out.sign ? index_t(result.wordwidth) : 0);
                         sinteger_tou(rregister(out), out);
                     }
                     else
@@ -628,59 +899,187 @@ private:
 
         h(flags);
     }
+
+    // Results of division are converted from the signedness of operation to their own.
+    template <bool _SignedOp, index_t _BitwidthR, bool _SignedR, typename _AllocatorR>
+    static void convert_div_result(integer<_BitwidthR, _SignedR, _AllocatorR>& result)
+    {
+        wregister& out = result.handle.get_wregister();
+        if (_SignedR != _SignedOp)
+        {
+            if (_SignedOp)
+            {
+                result.handle.reserve(out.sign ? index_t(result.wordwidth) : 0);
+                sinteger_tou(rregister(out), out);
+            }
+            else
+            {
+                uinteger_tos(rregister(out), out);
+            }
+        }
+    }
+
+    template <bool _SignedOp, index_t _BitwidthQ, bool _SignedQ, typename _AllocatorQ, index_t _BitwidthR, bool _SignedR, typename _AllocatorR>
+    static void div_operation(rregister left, rregister right, integer<_BitwidthQ, _SignedQ, _AllocatorQ>& quo, integer<_BitwidthR, _SignedR, _AllocatorR>& rem)
+    {
+        quo.handle.reserve(est_quo(left.size, right.size) + 1);
+        rem.handle.reserve(est_rem(left.size, right.size) + 1);
+        wregister& qout = quo.handle.get_wregister();
+        wregister& rout = rem.handle.get_wregister();
+        qout.sign = 0;
+        rout.sign = 0;
+        fregister flags = (_SignedOp ? sinteger_div(left, right, qout, rout) : uinteger_div(left, right, qout, rout));
+        convert_div_result<_SignedOp>(quo);
+        convert_div_result<_SignedOp>(rem);
+        fregister_handler_div(flags);
+    }
+
+    template <index_t _BitwidthO, bool _SignedO, typename _AllocatorO,
+              index_t _BitwidthQ, bool _SignedQ, typename _AllocatorQ,
+              index_t _BitwidthR, bool _SignedR, typename _AllocatorR>
+    void dispatch_div_operation(const integer<_BitwidthO, _SignedO, _AllocatorO>& other, integer<_BitwidthQ, _SignedQ, _AllocatorQ>& quo, integer<_BitwidthR, _SignedR, _AllocatorR>& rem) const
+    {
+        // Results may replace left only, as for operator/= and operator%=.
+        const void* right_address = &other;
+        if ((right_address == &quo) || (right_address == &rem))
+        {
+            this->dispatch_div_operation(integer<_BitwidthO, _SignedO, _AllocatorO>(other), quo, rem);
+            return;
+        }
+        // Dynamic result may move its words when it grows, left is copied if it is replaced.
+        const void* left_address = this;
+        if (handle_t::is_dynamic && ((left_address == &quo) || (left_address == &rem)))
+        {
+            integer(*this).dispatch_div_operation(other, quo, rem);
+            return;
+        }
+
+        if (_SignedO == _Signed)
+        {
+            div_operation<_Signed>(this->handle.get_rregister(), other.handle.get_rregister(), quo, rem);
+        }
+        else if ((declared_bitwidth(_BitwidthO) - _SignedO) > (declared_bitwidth(_Bitwidth) - _Signed))
+        {
+            integer<_BitwidthO, _SignedO, _AllocatorO> nleft{*this};
+            div_operation<_SignedO>(nleft.handle.get_rregister(), other.handle.get_rregister(), quo, rem);
+        }
+        else
+        {
+            integer<_Bitwidth, _Signed, _Allocator> nright{other};
+            div_operation<_Signed>(this->handle.get_rregister(), nright.handle.get_rregister(), quo, rem);
+        }
+    }
 };
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// division
+
+template <index_t _Bitwidth, bool _Signed, typename _Allocator, typename T>
+auto divmod(const integer<_Bitwidth, _Signed, _Allocator>& left, const T& right) -> decltype(left.divmod(right))
+{
+    return left.divmod(right);
+}
+
+template <typename T, index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+std::pair<integer<_Bitwidth, _Signed, _Allocator>, integer<_Bitwidth, _Signed, _Allocator>> divmod(const T& left, const integer<_Bitwidth, _Signed, _Allocator>& right)
+{
+    return integer<_Bitwidth, _Signed, _Allocator>(left).divmod(right);
+}
+
+template <index_t _Bitwidth, bool _Signed, typename _Allocator, typename T, index_t _BitwidthQ, bool _SignedQ, typename _AllocatorQ, index_t _BitwidthR, bool _SignedR, typename _AllocatorR>
+void divmod_into(const integer<_Bitwidth, _Signed, _Allocator>& left, const T& right, integer<_BitwidthQ, _SignedQ, _AllocatorQ>& quo, integer<_BitwidthR, _SignedR, _AllocatorR>& rem)
+{
+    left.divmod_into(right, quo, rem);
+}
+
+template <typename T, index_t _Bitwidth, bool _Signed, typename _Allocator, index_t _BitwidthQ, bool _SignedQ, typename _AllocatorQ, index_t _BitwidthR, bool _SignedR, typename _AllocatorR,
+          typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+void divmod_into(const T& left, const integer<_Bitwidth, _Signed, _Allocator>& right, integer<_BitwidthQ, _SignedQ, _AllocatorQ>& quo, integer<_BitwidthR, _SignedR, _AllocatorR>& rem)
+{
+    integer<_Bitwidth, _Signed, _Allocator>(left).divmod_into(right, quo, rem);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// chars
+
+template <index_t _Bitwidth, bool _Signed, typename _Allocator>
+to_chars_result to_chars(char* first, char* last, const integer<_Bitwidth, _Signed, _Allocator>& value, index_t base = AP_DEFAULT_STR_BASE,
+                         const char* digits = AP_DEFAULT_STR)
+{
+    return value.to_chars(first, last, base, digits);
+}
+
+template <index_t _Bitwidth, bool _Signed, typename _Allocator>
+from_chars_result from_chars(const char* first, const char* last, integer<_Bitwidth, _Signed, _Allocator>& value, index_t base = AP_DEFAULT_STR_BASE,
+                             const char* digits = AP_DEFAULT_STR)
+{
+    return value.from_chars(first, last, base, digits);
+}
+
+template <index_t _Bitwidth, bool _Signed, typename _Allocator>
+index_t required_chars(const integer<_Bitwidth, _Signed, _Allocator>& value, index_t base = AP_DEFAULT_STR_BASE, const char* digits = AP_DEFAULT_STR)
+{
+    return value.required_chars(base, digits);
+}
+
 } // namespace library
+
+using library::from_chars;
+using library::from_chars_result;
+using library::required_chars;
+using library::to_chars;
+using library::to_chars_result;
+
 } // namespace ap
 
-template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
-bool operator<(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)
+template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+bool operator<(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)
 {
     return right.cmp(left) != -1;
 }
 
-template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
-bool operator<=(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)
+template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+bool operator<=(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)
 {
     return right.cmp(left) != -1;
 }
 
-template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
-bool operator>(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)
+template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+bool operator>(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)
 {
     return right.cmp(left) != 1;
 }
 
-template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
-bool operator>=(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)
+template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+bool operator>=(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)
 {
     return right.cmp(left) != 1;
 }
 
-template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
-bool operator==(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)
+template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+bool operator==(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)
 {
     return right.cmp(left) == 0;
 }
 
-template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
-bool operator!=(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)
+template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false>
+bool operator!=(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)
 {
     return right.cmp(left) != 0;
 }
 
-#define AP_BASIC_OPERATOR(op)                                                                                                                    \
-    template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false> \
-    ap::library::integer<_Bitwidth, _Signed> operator op(const T& left, const ap::library::integer<_Bitwidth, _Signed>& right)                   \
-    {                                                                                                                                            \
-        return ap::library::integer<_Bitwidth, _Signed>(left) op right;                                                                          \
-    }                                                                                                                                            \
-                                                                                                                                                 \
-    template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename std::enable_if<std::is_integral<T>::value, bool>::type = false> \
-    T& operator op##=(T& left, const ap::library::integer<_Bitwidth, _Signed>& right)                                                            \
-    {                                                                                                                                            \
-        left = static_cast<T>(ap::library::integer<_Bitwidth, _Signed>(left) op right);                                                          \
-        return left;                                                                                                                             \
+#define AP_BASIC_OPERATOR(op)                                                                                                                                         \
+    template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false> \
+    ap::library::integer<_Bitwidth, _Signed, _Allocator> operator op(const T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)                \
+    {                                                                                                                                                                 \
+        return ap::library::integer<_Bitwidth, _Signed, _Allocator>(left) op right;                                                                                   \
+    }                                                                                                                                                                 \
+                                                                                                                                                                      \
+    template <typename T, ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator, typename std::enable_if<std::is_integral<T>::value, bool>::type = false> \
+    T& operator op##=(T& left, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& right)                                                                     \
+    {                                                                                                                                                                 \
+        left = static_cast<T>(ap::library::integer<_Bitwidth, _Signed, _Allocator>(left) op right);                                                                   \
+        return left;                                                                                                                                                  \
     }
 
 AP_BASIC_OPERATOR(+)
@@ -694,8 +1093,8 @@ AP_BASIC_OPERATOR(|)
 AP_BASIC_OPERATOR(<<)
 AP_BASIC_OPERATOR(>>)
 
-template <ap::library::index_t _Bitwidth, bool _Signed>
-std::ostream& operator<<(std::ostream& os, const ap::library::integer<_Bitwidth, _Signed>& val)
+template <ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator>
+std::ostream& operator<<(std::ostream& os, const ap::library::integer<_Bitwidth, _Signed, _Allocator>& val)
 {
     ap::library::index_t base = 10;
     if (os.flags() & std::ios_base::oct)
@@ -706,16 +1105,46 @@ std::ostream& operator<<(std::ostream& os, const ap::library::integer<_Bitwidth,
     {
         base = 16;
     }
-    os << val.str(base);
+    // Padding needs the whole string, otherwise it is written as it is produced.
+    if (os.width() != 0)
+    {
+        os << val.str(base);
+        return os;
+    }
+    for (ap::library::digit_generator gen = val.str_generator(base); gen.next();)
+    {
+        os.write(gen.data(), gen.size());
+    }
     return os;
 }
 
-template <ap::library::index_t _Bitwidth, bool _Signed>
-std::istream& operator>>(std::istream& is, ap::library::integer<_Bitwidth, _Signed>& val)
+template <ap::library::index_t _Bitwidth, bool _Signed, typename _Allocator>
+std::istream& operator>>(std::istream& is, ap::library::integer<_Bitwidth, _Signed, _Allocator>& val)
 {
-    std::string str;
-    is >> str;
-    val = str;
+    // Same base flags as for output, the base is detected by prefix otherwise.
+    ap::library::index_t base = 0;
+    if (is.flags() & std::ios_base::oct)
+    {
+        base = 8;
+    }
+    if (is.flags() & std::ios_base::hex)
+    {
+        base = 16;
+    }
+    std::istream::sentry sentry(is);
+    if (sentry)
+    {
+        std::ios_base::iostate state = std::ios_base::goodbit;
+        if (!val.read(*is.rdbuf(), base))
+        {
+            state |= std::ios_base::failbit;
+        }
+        if (std::istream::traits_type::eq_int_type(is.rdbuf()->sgetc(), std::istream::traits_type::eof()))
+        {
+            state |= std::ios_base::eofbit;
+        }
+        is.setstate(state);
+    }
     return is;
 }
 
@@ -4,7 +4,9 @@
 #if (DEOHAYER_AP_INT_ALG_CPP == 1) == defined(AP_USE_SOURCES)
 
 #include "asm.hpp"
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 namespace ap
 {
@@ -44,7 +46,7 @@ static inline fregister snorm(wregister& out, fregister flags)
 // Calculate how many bits are needed for base (string conversion utility, base is up to 256).
 static inline index_t min_bits_for_base(index_t base)
 {
-    static const index_t powers[8] = {1, 2, 4, 8, 18, 32, 64, 128};
+    static const index_t powers[8] = {1, 2, 4, 8, 16, 32, 64, 128};
     base = ((base == 0) ? 16 : base);
     index_t i = 0;
     for (i = 0; i < sizeof(powers) / sizeof(powers[0]); ++i)
@@ -57,6 +59,39 @@ static inline index_t min_bits_for_base(index_t base)
     return i;
 }
 
+// Largest power of base that fits in a word, it yields a chunk of digits per division (string conversion utility).
+struct radix_chunk
+{
+    dword_t power;
+    index_t digits;
+};
+
+// Base is up to 256.
+static inline const radix_chunk& chunk_for_base(index_t base)
+{
+    struct radix_table
+    {
+        radix_chunk chunks[257];
+
+        radix_table() : chunks()
+        {
+            for (index_t base = 2; base < 257; ++base)
+            {
+                radix_chunk& chunk = this->chunks[base];
+                chunk.power = base;
+                chunk.digits = 1;
+                while (chunk.power <= dword_t{word_traits::ones} / base)
+                {
+                    chunk.power *= base;
+                    ++chunk.digits;
+                }
+            }
+        }
+    };
+    static const radix_table table;
+    return table.chunks[base];
+}
+
 // Get prefix for the given 2, 8 or 16 base.
 static inline std::string prefix_for_base(index_t base)
 {
@@ -97,14 +132,8 @@ index_t est_fstr(index_t str_size, index_t base)
 
 index_t est_tstr(index_t in_size, index_t base)
 {
-    if (base == 2)
-    {
-        return in_size * word_traits::bits;
-    }
-    else
-    {
-        return ((in_size * word_traits::bits) / min_bits_for_base(base)) * 2;
-    }
+    // Chunk with one more digit does not fit in a word, so a word never holds more digits.
+    return in_size * (chunk_for_base(base).digits + 1) + 1;
 }
 
 index_t est_add(index_t left_size, index_t right_size)
@@ -137,11 +166,73 @@ index_t est_rem(index_t left_size, index_t right_size)
     return right_size;
 }
 
+index_t est_div_inv(index_t left_size, index_t right_size)
+{
+    return asm_div_inv_scratch(AP_MAX(left_size, right_size), right_size) + est_rem(left_size, right_size);
+}
+
 index_t est_bit(index_t left_size, index_t right_size)
 {
     return AP_MAX(left_size, right_size);
 }
 
+index_t est_mul_scratch(index_t left_size, index_t right_size)
+{
+    // Same choice of kernel as in uinteger_mul, squares need as much as products.
+    const index_t longer = AP_MAX(left_size, right_size);
+    const index_t shorter = AP_MIN(left_size, right_size);
+    if (shorter == 0)
+    {
+        return 0;
+    }
+    if (shorter < AP_KARATSUBA_THRESHOLD)
+    {
+        // Schoolbook product is written aside, if out refers to an operand.
+        return longer + shorter;
+    }
+    if (shorter < AP_TOOM3_THRESHOLD)
+    {
+        return asm_mul_karatsuba_scratch(longer, shorter);
+    }
+    if (shorter < AP_NTT_THRESHOLD)
+    {
+        return asm_mul_toom_scratch(longer, shorter);
+    }
+    if (shorter < AP_SSA_THRESHOLD)
+    {
+        return asm_mul_ntt_scratch(longer, shorter);
+    }
+    return asm_mul_ssa_scratch(longer, shorter);
+}
+
+index_t est_div_scratch(index_t left_size, index_t right_size)
+{
+    // Same choice of kernel as in uinteger_div, quotient and remainder with capacity 0 go first.
+    index_t scratch = 0;
+    if ((right_size >= 2) && (left_size >= right_size))
+    {
+        if (right_size < AP_BZ_THRESHOLD)
+        {
+            scratch = asm_div_scratch(left_size, right_size);
+        }
+        else if ((right_size < AP_NEWTON_THRESHOLD) || (left_size / right_size < 4))
+        {
+            scratch = asm_div_bz_scratch(left_size, right_size);
+        }
+        else
+        {
+            scratch = asm_div_newton_scratch(left_size, right_size);
+        }
+    }
+    return est_quo(left_size, right_size) + est_rem(left_size, right_size) + scratch;
+}
+
+index_t est_bit_scratch(index_t out_capacity)
+{
+    // Two's complement of both negative operands.
+    return 2 * out_capacity;
+}
+
 index_t est_lsh(index_t left_size, index_t bits)
 {
     index_t words = bits / word_traits::bits + bool(bits % word_traits::bits);
@@ -158,24 +249,638 @@ index_t est_rsh(index_t left_size, index_t bits)
     return left_size - words;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// String conversion utilities.
+
+// Power base^(k * 2^level), where base^k is the chunk power. Powers are cached per thread and per base, each level is
+// squared from the previous one once.
+static inline rregister radix_power(index_t base, index_t level)
+{
+    struct radix_powers
+    {
+        index_t base;
+        std::vector<array<word_t>> words;
+        std::vector<index_t> sizes;
+    };
+    thread_local std::vector<radix_powers> cache;
+
+    index_t i = 0;
+    while ((i < cache.size()) && (cache[i].base != base))
+    {
+        ++i;
+    }
+    if (i == cache.size())
+    {
+        cache.push_back(radix_powers{base, {}, {}});
+        // Chunk power takes two words only if the base itself does not fit in a word.
+        const dword_t power = chunk_for_base(base).power;
+        array<word_t> words = array_alloc<word_t>(2);
+        words[0] = static_cast<word_t>(power);
+        words[1] = static_cast<word_t>(power >> word_traits::bits);
+        cache[i].sizes.push_back((words[1] != 0) ? 2 : 1);
+        cache[i].words.push_back(std::move(words));
+    }
+    radix_powers& powers = cache[i];
+    while (powers.sizes.size() <= level)
+    {
+        const index_t size = powers.sizes.back();
+        const rregister last{powers.words.back().get(), size, size, false};
+        array<word_t> words = array_alloc<word_t>(2 * size);
+        wregister out{words.get(), 2 * size, 0, false};
+        uinteger_mul(last, last, out);
+        powers.sizes.push_back(out.size);
+        powers.words.push_back(std::move(words));
+    }
+    return rregister{powers.words[level].get(), powers.sizes[level], powers.sizes[level], false};
+}
+
+// Values of symbols in an alphabet, symbols that are not in it have value 256. The first occurrence of a symbol wins.
+struct digit_table
+{
+    unsigned short values[256];
+    // ASCII "0123456789" and "0123456789ABCDEF" have their usual values, eight of them are converted at once.
+    bool ascii_decimal;
+    bool ascii_hex;
+
+    digit_table(const char* digits, index_t size)
+    {
+        this->fill(digits, size);
+    }
+
+    void fill(const char* digits, index_t size)
+    {
+        for (index_t i = 0; i < 256; ++i)
+        {
+            this->values[i] = 256;
+        }
+        for (index_t j = size; j > 0; --j)
+        {
+            this->values[static_cast<unsigned char>(digits[j - 1])] = static_cast<unsigned short>(j - 1);
+        }
+#if AP_CASELESS_DIGITS
+        // Letters that are not in the alphabet take the value of the other case.
+        for (index_t upper = 'A'; upper <= 'Z'; ++upper)
+        {
+            const index_t lower = upper - 'A' + 'a';
+            if (this->values[upper] == 256)
+            {
+                this->values[upper] = this->values[lower];
+            }
+            else if (this->values[lower] == 256)
+            {
+                this->values[lower] = this->values[upper];
+            }
+        }
+#endif
+        this->ascii_decimal = true;
+        for (index_t j = 0; j < 10; ++j)
+        {
+            this->ascii_decimal = this->ascii_decimal && (this->values['0' + j] == j);
+        }
+        this->ascii_hex = this->ascii_decimal;
+        for (index_t j = 0; j < 6; ++j)
+        {
+            this->ascii_hex = this->ascii_hex && (this->values['A' + j] == 10 + j);
+        }
+    }
+};
+
+// Lookup table for digits[0, base). The default alphabet has a static table, any other alphabet is cached per thread
+// until a different one is used.
+static inline const digit_table& digit_table_for(const char* digits, index_t base)
+{
+    static const char default_digits[] = "0123456789ABCDEF";
+    static const digit_table default_table(default_digits, sizeof(default_digits) - 1);
+    if ((base < sizeof(default_digits)) && (std::memcmp(digits, default_digits, base) == 0))
+    {
+        return default_table;
+    }
+
+    struct cached_table
+    {
+        digit_table table;
+        char digits[256];
+        index_t size;
+
+        cached_table() : table(nullptr, 0), digits(), size(0)
+        {
+        }
+    };
+    static thread_local cached_table cache;
+    if ((cache.size != base) || (std::memcmp(cache.digits, digits, base) != 0))
+    {
+        std::memcpy(cache.digits, digits, base);
+        cache.size = base;
+        cache.table.fill(digits, base);
+    }
+    return cache.table;
+}
+
+// Value of symbol in the alphabet of table.
+// Return: at least base, if symbol is not a digit.
+static inline index_t digit_value(char symbol, const digit_table& table)
+{
+    return table.values[static_cast<unsigned char>(symbol)];
+}
+
+// Eight symbols of str as bytes of an integer, str[0] is the least significant one (string conversion utility).
+static inline unsigned long long swar_load(const char* str)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str);
+    // Compilers merge it into a single load on little endian targets.
+    return AP_LLU(bytes[0]) | (AP_LLU(bytes[1]) << 8) | (AP_LLU(bytes[2]) << 16) | (AP_LLU(bytes[3]) << 24) |
+           (AP_LLU(bytes[4]) << 32) | (AP_LLU(bytes[5]) << 40) | (AP_LLU(bytes[6]) << 48) | (AP_LLU(bytes[7]) << 56);
+}
+
+// value = eight ASCII decimal digits of str, the first one is the most significant.
+// Return: false, if some symbol is not a decimal digit.
+static inline bool swar_decimal(const char* str, unsigned long long& value)
+{
+    unsigned long long x = swar_load(str);
+    // High nibbles must be 3, low nibbles must not exceed 9.
+    if (((x & 0xF0F0F0F0F0F0F0F0ull) | (((x + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) != 0x3333333333333333ull)
+    {
+        return false;
+    }
+    // Pairs, quads and the octet are merged by multiplication.
+    x -= 0x3030303030303030ull;
+    x = (x * 10) + (x >> 8);
+    x = (((x & 0x000000FF000000FFull) * 0x000F424000000064ull) + (((x >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+    value = x & 0xFFFFFFFFull;
+    return true;
+}
+
+// value = eight ASCII uppercase hexadecimal digits of str, the first one is the most significant.
+// Return: false, if some symbol is not a hexadecimal digit.
+static inline bool swar_hex(const char* str, unsigned long long& value)
+{
+    const unsigned long long ones = 0x0101010101010101ull;
+    const unsigned long long high = ones * 0x80;
+    unsigned long long x = swar_load(str);
+    if ((x & high) != 0)
+    {
+        return false;
+    }
+    // High bit of each byte tells whether the symbol is in the range, symbols below 0x80 never carry to the next byte.
+    const unsigned long long digit = ((x + ones * (0x80 - '0')) & ~(x + ones * (0x7F - '9')) & high);
+    const unsigned long long letter = ((x + ones * (0x80 - 'A')) & ~(x + ones * (0x7F - 'F')) & high);
+    if ((digit | letter) != high)
+    {
+        return false;
+    }
+    x = (x & (ones * 0x0F)) + (letter >> 7) * 9;
+    // Nibbles are packed in pairs, quads and the octet.
+    x = ((x << 4) | (x >> 8)) & 0x00FF00FF00FF00FFull;
+    x = ((x << 8) | (x >> 16)) & 0x0000FFFF0000FFFFull;
+    x = ((x << 16) | (x >> 32)) & 0xFFFFFFFFull;
+    value = x;
+    return true;
+}
+
+// out = value of str[0, size) by Horner's rule, each step folds in as many digits as a word can hold. Conversion stops at
+// the first unknown symbol, the value wraps to out.capacity.
+static fregister fstr_chunks(wregister& out, const char* str, index_t size, index_t base, const digit_table& table)
+{
+    fregister flags;
+    const radix_chunk& chunk = chunk_for_base(base);
+    const bool decimal8 = ((base == 10) && table.ascii_decimal && (chunk.digits >= 8));
+    out.size = 0;
+    index_t i = 0;
+    bool stop = false;
+    while (!stop && (i < size))
+    {
+        word_t value = 0;
+        dword_t power = 1;
+        const index_t end = AP_MIN(size, i + chunk.digits);
+        unsigned long long eight = 0;
+        for (; decimal8 && (end - i >= 8) && swar_decimal(str + i, eight); i += 8)
+        {
+            value = static_cast<word_t>(value * 100000000ull + eight);
+            power *= 100000000ull;
+        }
+        for (; i < end; ++i)
+        {
+            const index_t j = digit_value(str[i], table);
+            // Unknown symbol encountered.
+            if (j >= base)
+            {
+                stop = true;
+                break;
+            }
+            value = static_cast<word_t>(value * base + j);
+            power *= base;
+        }
+        if (power == 1)
+        {
+            break;
+        }
+        if (out.size == 0)
+        {
+            if ((value != 0) && (out.capacity != 0))
+            {
+                out.words[0] = value;
+                out.size = 1;
+            }
+        }
+        else
+        {
+            const rregister left = rregister(out);
+            const rregister right{&value, 1, 1, false};
+            out.size = 0;
+            dword_t carry = asm_mul_short(left, power, out);
+            carry |= asm_add(rregister(out), right, out);
+            if (carry != 0)
+            {
+                flags.set(fregister::overflow);
+            }
+            asm_trim(out);
+        }
+    }
+    return flags;
+}
+
+// out = value of str[0, size), str is split into high part and low part of k * 2^level digits.
+// Preconditions:
+// str[0, size) consists of digits only.
+// out.capacity >= est_fstr(size, base) + 1.
+static void fstr_dc(wregister& out, const char* str, index_t size, index_t base, const digit_table& table, index_t level)
+{
+    const index_t chunk_digits = chunk_for_base(base).digits;
+    if (size < AP_FSTR_THRESHOLD * chunk_digits)
+    {
+        fstr_chunks(out, str, size, base, table);
+        return;
+    }
+    while ((level > 0) && ((chunk_digits << level) * 2 > size))
+    {
+        --level;
+    }
+    const index_t low_size = (chunk_digits << level);
+    const index_t high_size = size - low_size;
+
+    const index_t high_capacity = est_fstr(high_size, base) + 1;
+    const index_t low_capacity = est_fstr(low_size, base) + 1;
+    array<word_t> parts = array_alloc<word_t>(high_capacity + low_capacity);
+    wregister high{parts.get(), high_capacity, 0, false};
+    wregister low{parts.get() + high_capacity, low_capacity, 0, false};
+    fstr_dc(high, str, high_size, base, table, level);
+    fstr_dc(low, str + high_size, low_size, base, table, level);
+    uinteger_mul(rregister(high), radix_power(base, level), out);
+    uinteger_add(rregister(out), rregister(low), out);
+}
+
+// Output buffer of digits, least significant first. Digits past the capacity are only counted.
+struct digit_sink
+{
+    char* first;
+    index_t capacity;
+    index_t count;
+
+    void put(char symbol)
+    {
+        if (this->count < this->capacity)
+        {
+            this->first[this->count] = symbol;
+        }
+        ++this->count;
+    }
+};
+
+// Digits of in, least significant first, zeros are appended up to pad digits. Each division by the chunk power yields
+// several digits at once, the last word yields the rest.
+// Preconditions:
+// in.size < AP_TSTR_THRESHOLD.
+static void tstr_chunks(const rregister& in, digit_sink& sink, index_t base, const char* digits, index_t pad)
+{
+    // Local copy stays in registers, symbols written through sink.first may alias anything.
+    digit_sink out = sink;
+    const index_t start_count = out.count;
+    const radix_chunk& chunk = chunk_for_base(base);
+    word_t last = ((in.size != 0) ? in.words[0] : 0);
+    if (in.size > 1)
+    {
+        // Temporary quotient.
+        word_t quo_words[AP_TSTR_THRESHOLD];
+        wregister quo{&quo_words[0], in.size, in.size, false};
+        // Temporary remainder.
+        word_t rem_words[1];
+        wregister rem{&rem_words[0], 1, 1, false};
+        rregister left = in;
+        while (left.size > 1)
+        {
+            asm_div_short(left, chunk.power, quo, rem);
+            asm_trim(quo);
+            word_t value = rem.words[0];
+            if (out.count + chunk.digits <= out.capacity)
+            {
+                char* const symbols = out.first + out.count;
+                for (index_t i = 0; i < chunk.digits; ++i)
+                {
+                    symbols[i] = digits[value % base];
+                    value = static_cast<word_t>(value / base);
+                }
+            }
+            out.count += chunk.digits;
+            left = rregister(quo);
+        }
+        last = left.words[0];
+    }
+    for (; last != 0; last = static_cast<word_t>(last / base))
+    {
+        out.put(digits[last % base]);
+    }
+    while (out.count - start_count < pad)
+    {
+        out.put(digits[0]);
+    }
+    sink = out;
+}
+
+// Digits of in, least significant first, zeros are appended up to pad digits. in is split by base^(k * 2^level) into
+// quotient and remainder, the latter yields exactly k * 2^level digits.
+static void tstr_dc(const rregister& in, digit_sink& sink, index_t base, const char* digits, index_t level, index_t pad)
+{
+    if (in.size < AP_TSTR_THRESHOLD)
+    {
+        tstr_chunks(in, sink, base, digits, pad);
+        return;
+    }
+    rregister power = radix_power(base, level);
+    while ((level > 0) && (2 * power.size > in.size + 1))
+    {
+        --level;
+        power = radix_power(base, level);
+    }
+    const index_t low_digits = (chunk_for_base(base).digits << level);
+
+    const index_t quo_capacity = est_quo(in.size, power.size);
+    array<word_t> parts = array_alloc<word_t>(quo_capacity + power.size);
+    wregister quo{parts.get(), quo_capacity, 0, false};
+    wregister rem{parts.get() + quo_capacity, power.size, 0, false};
+    uinteger_div(in, power, quo, rem);
+    tstr_dc(rregister(rem), sink, base, digits, level, low_digits);
+    tstr_dc(rregister(quo), sink, base, digits, level, ((pad > low_digits) ? pad - low_digits : 0));
+}
+
+// Bits per digit if base is a power of two (string conversion utility).
+// Return: 0, if base is not a power of two.
+static inline index_t pow2_bits_for_base(index_t base)
+{
+    if ((base < 2) || ((base & (base - 1)) != 0))
+    {
+        return 0;
+    }
+    return min_bits_for_base(base);
+}
+
+// out = value of str[0, size) in a power of two base, digits are sliced into words starting from the least significant one.
+// Bits that do not fit in out.capacity are dropped.
+// Preconditions:
+// str[0, size) consists of digits only.
+static fregister fstr_pow2(wregister& out, const char* str, index_t size, index_t base, const digit_table& table)
+{
+    fregister flags;
+    const index_t bits = pow2_bits_for_base(base);
+    // Eight digits take 32 bits, they fit in the accumulator along with less than a word.
+    const bool hex8 = ((base == 16) && table.ascii_hex && (word_traits::bits >= 32));
+    dword_t acc = 0;
+    index_t acc_bits = 0;
+    out.size = 0;
+    for (index_t i = size; i > 0;)
+    {
+        unsigned long long eight = 0;
+        if (hex8 && (i >= 8) && swar_hex(str + i - 8, eight))
+        {
+            acc |= static_cast<dword_t>(eight) << acc_bits;
+            acc_bits += 32;
+            i -= 8;
+        }
+        else
+        {
+            acc |= static_cast<dword_t>(digit_value(str[i - 1], table)) << acc_bits;
+            acc_bits += bits;
+            --i;
+        }
+        if (acc_bits >= word_traits::bits)
+        {
+            const word_t word = static_cast<word_t>(acc);
+            if (out.size < out.capacity)
+            {
+                out.words[out.size++] = word;
+            }
+            else if (word != 0)
+            {
+                flags.set(fregister::overflow);
+            }
+            acc >>= word_traits::bits;
+            acc_bits -= word_traits::bits;
+        }
+    }
+    if (acc_bits != 0)
+    {
+        if (out.size < out.capacity)
+        {
+            out.words[out.size++] = static_cast<word_t>(acc);
+        }
+        else if (acc != 0)
+        {
+            flags.set(fregister::overflow);
+        }
+    }
+    asm_trim(out);
+    return flags;
+}
+
+// Digits of in in a power of two base, most significant first, digits are sliced from words starting from the least
+// significant one. Nothing is written if the digits do not fit in capacity.
+// Return: number of digits.
+// Preconditions:
+// Trimmed nonzero in.
+static index_t tstr_pow2(const rregister& in, char* first, index_t capacity, index_t base, const char* digits)
+{
+    const index_t bits = pow2_bits_for_base(base);
+    const word_t mask = static_cast<word_t>(base - 1);
+    index_t top_bits = 0;
+    for (word_t top = in.words[in.size - 1]; top != 0; top = static_cast<word_t>(top >> 1))
+    {
+        ++top_bits;
+    }
+    const index_t total_bits = (in.size - 1) * word_traits::bits + top_bits;
+    const index_t count = (total_bits + bits - 1) / bits;
+    if (count > capacity)
+    {
+        return count;
+    }
+    char* pos = first + count;
+    dword_t acc = 0;
+    index_t acc_bits = 0;
+    // Digits of the lower words never exceed the digit count, so only the top word needs a bound.
+    for (index_t i = 0; i + 1 < in.size; ++i)
+    {
+        acc |= dword_t{in.words[i]} << acc_bits;
+        acc_bits += word_traits::bits;
+        for (; acc_bits >= bits; acc_bits -= bits)
+        {
+            *--pos = digits[static_cast<word_t>(acc) & mask];
+            acc >>= bits;
+        }
+    }
+    acc |= dword_t{in.words[in.size - 1]} << acc_bits;
+    while (pos != first)
+    {
+        *--pos = digits[static_cast<word_t>(acc) & mask];
+        acc >>= bits;
+    }
+    return count;
+}
+
+// Number of leading symbols of str[0, size) which are digits.
+static inline index_t digit_count(const char* str, index_t size, index_t base, const digit_table& table)
+{
+    index_t count = 0;
+    unsigned long long eight = 0;
+    if ((base == 10) && table.ascii_decimal)
+    {
+        while ((size - count >= 8) && swar_decimal(str + count, eight))
+        {
+            count += 8;
+        }
+    }
+    else if ((base == 16) && table.ascii_hex)
+    {
+        while ((size - count >= 8) && swar_hex(str + count, eight))
+        {
+            count += 8;
+        }
+    }
+    while ((count < size) && (digit_value(str[count], table) < base))
+    {
+        ++count;
+    }
+    return count;
+}
+
+// out = value of str[0, size), the value wraps to out.capacity.
+// Preconditions:
+// str[0, size) consists of digits only.
+static fregister fstr_digits(wregister& out, const char* str, index_t size, index_t base, const digit_table& table)
+{
+    fregister flags;
+    const radix_chunk& chunk = chunk_for_base(base);
+    if (pow2_bits_for_base(base) != 0)
+    {
+        flags = fstr_pow2(out, str, size, base, table);
+    }
+    else if (size < AP_FSTR_THRESHOLD * chunk.digits)
+    {
+        flags = fstr_chunks(out, str, size, base, table);
+    }
+    else
+    {
+        // Long strings are split in halves recursively.
+        index_t level = 0;
+        while ((chunk.digits << (level + 1)) * 2 <= size)
+        {
+            ++level;
+        }
+        const index_t capacity = est_fstr(size, base) + 1;
+        array<word_t> value_words = array_alloc<word_t>(capacity);
+        wregister value{value_words.get(), capacity, 0, false};
+        fstr_dc(value, str, size, base, table, level);
+        // Value wraps to out.capacity.
+        if (value.size > out.capacity)
+        {
+            value.size = out.capacity;
+            flags.set(fregister::overflow);
+        }
+        asm_cp(rregister(value), out);
+    }
+    return flags;
+}
+
+// out = base^exp.
+// Preconditions:
+// out.capacity >= est_fstr(exp, base) + 1.
+static void radix_pow(index_t base, index_t exp, wregister& out)
+{
+    const radix_chunk& chunk = chunk_for_base(base);
+    word_t low = 1;
+    for (index_t i = 0; i < exp % chunk.digits; ++i)
+    {
+        low = static_cast<word_t>(low * base);
+    }
+    out.words[0] = low;
+    out.size = 1;
+    // Cached powers are base^(k * 2^level), they are picked by bits of exp / k.
+    array<word_t> product_words = array_alloc<word_t>(out.capacity);
+    wregister product{product_words.get(), out.capacity, 0, false};
+    for (index_t level = 0, rest = exp / chunk.digits; rest != 0; ++level, rest >>= 1)
+    {
+        if ((rest & 1) != 0)
+        {
+            uinteger_mul(rregister(out), radix_power(base, level), product);
+            asm_cp(rregister(product), out);
+        }
+    }
+}
+
+// Digits of in, most significant first, zero is a single digit. If the digits do not fit in capacity, contents of
+// first[0, capacity) are unspecified.
+// Return: number of digits.
+static index_t tstr_digits(const rregister& in, char* first, index_t capacity, index_t base, const char* digits)
+{
+    // Trivial case.
+    if (in.size == 0)
+    {
+        if (capacity != 0)
+        {
+            first[0] = '0';
+        }
+        return 1;
+    }
+    // Power of two bases are sliced from bits directly in the right order.
+    if (pow2_bits_for_base(base) != 0)
+    {
+        return tstr_pow2(in, first, capacity, base, digits);
+    }
+    digit_sink sink{first, capacity, 0};
+    if (in.size < AP_TSTR_THRESHOLD)
+    {
+        tstr_chunks(in, sink, base, digits, 0);
+    }
+    else
+    {
+        // Long values are split in halves recursively, the first split is by about square root of the value.
+        index_t level = 0;
+        while (4 * radix_power(base, level).size - 1 <= in.size)
+        {
+            ++level;
+        }
+        tstr_dc(in, sink, base, digits, level, 0);
+    }
+    if (sink.count <= capacity)
+    {
+        // Swap to obtain correct order.
+        std::reverse(first, first + sink.count);
+    }
+    return sink.count;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // uapi definitions.
 
 fregister uinteger_fstr(wregister& out, const char* str, index_t size, index_t base, const char* digits)
 {
     fregister flags{};
-    // Arithmetic base for out.
-    static constexpr dword_t divisor = dword_t{word_traits::ones} + 1;
     out.size = 0;
     // Trivial case.
     if (size == 0)
     {
         return flags;
     }
-    // Register to hold the full value. Memory will be allocated later.
-    wregister nout{nullptr, 0, 0, str[0] == '-'};
+    const bool negative = (str[0] == '-');
     // Adjust if sign is present.
-    if (nout.sign == 1 || str[0] == '+')
+    if (negative || str[0] == '+')
     {
         ++str;
         --size;
@@ -210,109 +915,12 @@ fregister uinteger_fstr(wregister& out, const char* str, index_t size, index_t b
     {
         base = detected_base;
     }
-    // Transform str to raw form, where each symbol is mapped to [0, base) value.
-    // raw_str will be a backwards representation of str, with raw_str[0] as the most significant digit.
-    auto raw_str = array_alloc<unsigned char>(size);
-    index_t raw_size = size;
-    for (index_t i = 0; i < raw_size; ++i)
-    {
-        index_t j = 0;
-        // Find symbol in digits array, index will be its value.
-        for (j = 0; j < base; ++j)
-        {
-            // If symbol found in digits, append its value to raw_str.
-            if (str[i] == digits[j])
-            {
-                raw_str[i] = static_cast<unsigned char>(j);
-
-                break;
-            }
-        }
-        // Unknown symbol encountered.
-        if (j == base)
-        {
-            raw_size = i;
-            break;
-        }
-    }
-    // Allocate memory for nout to hold the full value.
-    nout.capacity = est_fstr(raw_size, base);
-    auto nout_words = array_alloc<word_t>(nout.capacity);
-    nout.words = nout_words.get();
-    // Perform base translation using classical approach.
-    const dword_t raw_base = base;
-    dword_t dividend = 0;
-    index_t str_i = 0; // for reading values from raw_str
-    index_t str_j = 0; // for writing values to raw_str
-    while (raw_size > 0)
-    {
-        // Perform single division.
-        str_i = 0;
-        str_j = 0;
-        dividend = 0;
-        // Get the first digit of the result.
-        for (str_i = 0; str_i < raw_size; ++str_i)
-        {
-            dividend *= raw_base;
-            dividend += raw_str[str_i];
-            if (dividend >= divisor)
-            {
-                raw_str[str_j] = static_cast<unsigned char>(dividend / divisor);
-                ++str_j;
-                dividend %= divisor;
-                break;
-            }
-        }
-        // Case of the last division.
-        if (str_j == 0)
-        {
-            nout.words[nout.size] = static_cast<word_t>(dividend);
-            ++nout.size;
-            break;
-        }
-        // At this point, for loop above was terminated through break.
-        // str_i still refers to already processed element.
-        ++str_i;
-        // Get the rest of the digits.
-        while (str_i < raw_size)
-        {
-
-            dividend *= raw_base;
-            dividend += raw_str[str_i];
-            ++str_i;
-            if (dividend >= divisor)
-            {
-                raw_str[str_j] = static_cast<unsigned char>(dividend / divisor);
-                ++str_j;
-                dividend %= divisor;
-            }
-            else
-            {
-                raw_str[str_j] = 0;
-                ++str_j;
-            }
-        }
-        // Update size.
-        raw_size = str_j;
-        // dividend contains remainder of the whole division.
-        nout.words[nout.size] = static_cast<word_t>(dividend);
-        ++nout.size;
-    }
-    // Copy and adjust the result.
-    out.size = AP_MIN(nout.size, out.capacity);
-    if (out.size != nout.size)
-    {
-        nout.size = out.size;
-        flags.set(fregister::overflow);
-    }
+    const digit_table& table = digit_table_for(digits, base);
+    flags = fstr_digits(out, str, digit_count(str, size, base, table), base, table);
     // If value was with "-" sign it has to be converted to two's complement variant.
-    if (nout.sign == 1)
-    {
-        asm_twos(rregister(nout), out);
-    }
-    else
+    if (negative)
     {
-        asm_cp(rregister(nout), out);
+        asm_twos(rregister(out), out);
     }
     asm_trim(out);
     return flags;
@@ -324,36 +932,66 @@ void uinteger_tstr(const rregister& in, std::string& str, index_t base, const ch
     {
         str.append(prefix_for_base(base));
     }
-    index_t start_index = str.size(); // Index where actual number starts, used to reverse string in the end.
-    // Trivial case.
-    if (in.size == 0)
+    const index_t start_index = str.size();
+    str.resize(start_index + est_tstr(in.size, base));
+    str.resize(start_index + tstr_digits(in, &str[start_index], str.size() - start_index, base, digits));
+}
+
+index_t uinteger_tstr_split(const rregister& in, index_t base, wregister& quo, wregister& rem)
+{
+    // The same split as in tstr_dc, remainder is about half of in.
+    index_t level = 0;
+    while (2 * radix_power(base, level + 1).size <= in.size + 1)
     {
-        str.push_back('0');
-        return;
-    }
-    // Temporary quotient.
-    array<word_t> quo_words = array_alloc<word_t>(in.size);
-    wregister quo{quo_words.get(), in.size, in.size, false};
-    // Temporary remainder.
-    word_t rem_words[1];
-    wregister rem{&rem_words[0], 1, 1, false};
-    // First division.
-    asm_div_short(in, base, quo, rem);
-    str.push_back(digits[rem.words[0]]);
-    asm_trim(quo);
-    // Subsequent divisions.
-    while (quo.size != 0)
-    {
-        asm_div_short(rregister(quo), base, quo, rem);
-        str.push_back(digits[rem.words[0]]);
-        asm_trim(quo);
+        ++level;
     }
-    // Swap to obtain correct order.
-    index_t end_index = (str.size() - start_index) / 2;
-    for (index_t i = 0; i < end_index; ++i)
+    uinteger_div(in, radix_power(base, level), quo, rem);
+    return (chunk_for_base(base).digits << level);
+}
+
+index_t est_fchars(const char* str, index_t size, index_t base, const char* digits)
+{
+    const bool negative = ((size != 0) && (str[0] == '-'));
+    return est_fstr(digit_count(str + negative, size - negative, base, digit_table_for(digits, base)), base);
+}
+
+index_t uinteger_fchars(wregister& out, const char* str, index_t size, index_t base, const char* digits, fregister& flags)
+{
+    out.size = 0;
+    flags = fregister{};
+    return uinteger_fchars_append(out, str, size, base, digits, flags);
+}
+
+index_t uinteger_fchars_append(wregister& out, const char* str, index_t size, index_t base, const char* digits, fregister& flags)
+{
+    const digit_table& table = digit_table_for(digits, base);
+    const index_t count = digit_count(str, size, base, table);
+    if (count == 0)
     {
-        std::swap(str[i + start_index], str[str.size() - i - 1]);
+        return 0;
     }
+    if (out.size == 0)
+    {
+        flags = flags | fstr_digits(out, str, count, base, table);
+        return count;
+    }
+    // out = out * base^count + value.
+    const index_t value_capacity = est_fstr(count, base) + 1;
+    const index_t shifted_capacity = out.size + value_capacity;
+    array<word_t> parts = array_alloc<word_t>(2 * value_capacity + shifted_capacity);
+    wregister power{parts.get(), value_capacity, 0, false};
+    wregister value{parts.get() + value_capacity, value_capacity, 0, false};
+    wregister shifted{parts.get() + 2 * value_capacity, shifted_capacity, 0, false};
+    radix_pow(base, count, power);
+    fstr_digits(value, str, count, base, table);
+    uinteger_mul(rregister(out), rregister(power), shifted);
+    flags = flags | uinteger_add(rregister(shifted), rregister(value), out);
+    return count;
+}
+
+index_t uinteger_tchars(const rregister& in, char* first, index_t capacity, index_t base, const char* digits)
+{
+    return tstr_digits(in, first, capacity, base, digits);
 }
 
 fregister uinteger_fbasic(wregister& out, unsigned long long basic)
@@ -466,7 +1104,7 @@ fregister uinteger_sub(rregister left, rregister right, wregister& out)
     return flags;
 }
 
-fregister uinteger_mul(rregister left, rregister right, wregister& out)
+fregister uinteger_mul(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     fregister flags;
     // Reorder operands.
@@ -486,26 +1124,78 @@ fregister uinteger_mul(rregister left, rregister right, wregister& out)
         flags.set(flags.overflow);
     }
 
+    // Kernel for wrapped operands may need more scratch than estimated by the caller.
+    const index_t left_size = left.size;
+    const index_t right_size = right.size;
     WRAP(left, out);
     WRAP(right, out);
-    // Perform actual multiplication.
+    if ((scratch != nullptr) && (left.size != left_size) &&
+        (est_mul_scratch(left.size, right.size) > est_mul_scratch(left_size, right_size)))
+    {
+        scratch = nullptr;
+    }
+    // Perform actual multiplication. Only schoolbook multiplication cannot write over its operands.
     wregister nout = out;
     array<word_t> nout_words = array_null<word_t>();
     nout.size = 0;
-    if ((out.words == left.words) || (out.words == right.words))
+    dword_t carry = 0;
+    if ((left.words == right.words) && (left.size == right.size))
     {
-        nout_words = array_alloc<word_t>(nout.capacity);
-        nout.words = nout_words.get();
+        if (right.size < AP_KARATSUBA_THRESHOLD)
+        {
+            carry = asm_sqr(left, nout, scratch);
+        }
+        else if (right.size < AP_TOOM3_THRESHOLD)
+        {
+            carry = asm_sqr_karatsuba(left, nout, scratch);
+        }
+        else if (right.size < AP_NTT_THRESHOLD)
+        {
+            carry = asm_sqr_toom(left, nout, scratch);
+        }
+        else if (right.size < AP_SSA_THRESHOLD)
+        {
+            carry = asm_mul_ntt(left, right, nout, scratch);
+        }
+        else
+        {
+            carry = asm_mul_ssa(left, right, nout, scratch);
+        }
     }
-    dword_t carry = 0;
-    if (right.size == 1)
+    else if (right.size == 1)
     {
         carry = asm_mul_short(left, right.words[0], nout);
     }
-    else
+    else if (right.size < AP_KARATSUBA_THRESHOLD)
     {
+        if ((out.words == left.words) || (out.words == right.words))
+        {
+            nout.capacity = AP_MIN(nout.capacity, left.size + right.size);
+            if (scratch == nullptr)
+            {
+                nout_words = array_alloc<word_t>(nout.capacity);
+                scratch = nout_words.get();
+            }
+            nout.words = scratch;
+        }
         carry = asm_mul(left, right, nout);
     }
+    else if (right.size < AP_TOOM3_THRESHOLD)
+    {
+        carry = asm_mul_karatsuba(left, right, nout, scratch);
+    }
+    else if (right.size < AP_NTT_THRESHOLD)
+    {
+        carry = asm_mul_toom(left, right, nout, scratch);
+    }
+    else if (right.size < AP_SSA_THRESHOLD)
+    {
+        carry = asm_mul_ntt(left, right, nout, scratch);
+    }
+    else
+    {
+        carry = asm_mul_ssa(left, right, nout, scratch);
+    }
 
     if (carry != 0)
     {
@@ -523,7 +1213,12 @@ fregister uinteger_mul(rregister left, rregister right, wregister& out)
     return flags;
 }
 
-fregister uinteger_div(rregister left, rregister right, wregister& quo, wregister& rem)
+fregister uinteger_mul(rregister left, rregister right, wregister& out)
+{
+    return uinteger_mul(left, right, out, nullptr);
+}
+
+fregister uinteger_div(rregister left, rregister right, wregister& quo, wregister& rem, word_t* scratch)
 {
     fregister flags;
     // Glorious zero division.
@@ -534,20 +1229,33 @@ fregister uinteger_div(rregister left, rregister right, wregister& quo, wregiste
         flags.set(fregister::infinity);
         return flags;
     }
-    // Setup quotient and remainder, if necessary.
+    // Setup quotient and remainder, if necessary. They take the head of scratch, the kernel takes the rest.
     array<word_t> quo_words = array_null<word_t>();
     array<word_t> rem_words = array_null<word_t>();
-    if (quo.capacity == 0)
+    const bool quo_scratch = (quo.capacity == 0);
+    const bool rem_scratch = (rem.capacity == 0);
+    word_t* kernel_scratch = nullptr;
+    if (scratch != nullptr)
+    {
+        kernel_scratch = scratch + est_quo(left.size, right.size) + est_rem(left.size, right.size);
+    }
+    if (quo_scratch)
     {
         quo.capacity = est_quo(left.size, right.size);
-        quo_words = array_alloc<word_t>(quo.capacity);
-        quo.words = quo_words.get();
+        if (scratch == nullptr)
+        {
+            quo_words = array_alloc<word_t>(quo.capacity);
+        }
+        quo.words = ((scratch != nullptr) ? scratch : quo_words.get());
     }
-    if (rem.capacity == 0)
+    if (rem_scratch)
     {
         rem.capacity = est_rem(left.size, right.size);
-        rem_words = array_alloc<word_t>(rem.capacity);
-        rem.words = rem_words.get();
+        if (scratch == nullptr)
+        {
+            rem_words = array_alloc<word_t>(rem.capacity);
+        }
+        rem.words = ((scratch != nullptr) ? scratch + est_quo(left.size, right.size) : rem_words.get());
     }
     // If left is obviously less, return immediately.
     if (left.size < right.size)
@@ -566,34 +1274,106 @@ fregister uinteger_div(rregister left, rregister right, wregister& quo, wregiste
         {
             asm_div_short(left, right.words[0], quo, rem);
         }
+        else if (right.size < AP_BZ_THRESHOLD)
+        {
+            asm_div(left, right, quo, rem, kernel_scratch);
+        }
+        else if ((right.size < AP_NEWTON_THRESHOLD) || (left.size / right.size < 4))
+        {
+            // Reciprocal costs about four multiplications, it pays off for long quotients only.
+            asm_div_bz(left, right, quo, rem, kernel_scratch);
+        }
         else
         {
-            asm_div(left, right, quo, rem);
+            asm_div_newton(left, right, quo, rem, kernel_scratch);
         }
     }
-    if (quo_words.get() != nullptr)
+    // Temporary results are dropped, the requested ones are trimmed.
+    if (quo_scratch)
     {
         quo.words = nullptr;
+    }
+    else
+    {
+        asm_trim(quo);
+    }
+    if (rem_scratch)
+    {
+        rem.words = nullptr;
+    }
+    else
+    {
         asm_trim(rem);
     }
-    if (rem_words.get() != nullptr)
+    return flags;
+}
+
+fregister uinteger_div(rregister left, rregister right, wregister& quo, wregister& rem)
+{
+    return uinteger_div(left, right, quo, rem, nullptr);
+}
+
+fregister uinteger_div_inv(rregister left, rregister right, rregister inverse, wregister& quo, wregister& rem, word_t* scratch)
+{
+    fregister flags;
+    // Remainder is still needed by division, it is kept in the tail of scratch.
+    const bool rem_scratch = (rem.capacity == 0);
+    if (rem_scratch)
+    {
+        rem.capacity = est_rem(left.size, right.size);
+        rem.words = scratch + asm_div_inv_scratch(AP_MAX(left.size, right.size), right.size);
+    }
+    // If left is obviously less, return immediately.
+    if (left.size < right.size)
+    {
+        quo.size = 0;
+        flags |= uinteger_scp(left, rem);
+    }
+    else
+    {
+        // Do not wrap, bit pattern will be wrong.
+        if (((quo.capacity != 0) && (left.size + 1 - right.size > quo.capacity)) || (right.size > rem.capacity))
+        {
+            flags |= fregister::overflow;
+        }
+        asm_div_inv(left, right, inverse, quo, rem, scratch);
+    }
+    if (rem_scratch)
     {
         rem.words = nullptr;
+        rem.capacity = 0;
+    }
+    else
+    {
+        asm_trim(rem);
+    }
+    if (quo.capacity != 0)
+    {
         asm_trim(quo);
     }
     return flags;
 }
 
-fregister uinteger_quo(rregister left, rregister right, wregister& out)
+fregister uinteger_quo(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     wregister rem{nullptr, 0, 0, false};
-    return uinteger_div(left, right, out, rem);
+    return uinteger_div(left, right, out, rem, scratch);
 }
 
-fregister uinteger_rem(rregister left, rregister right, wregister& out)
+fregister uinteger_quo(rregister left, rregister right, wregister& out)
+{
+    return uinteger_quo(left, right, out, nullptr);
+}
+
+fregister uinteger_rem(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     wregister quo{nullptr, 0, 0, false};
-    return uinteger_div(left, right, quo, out);
+    return uinteger_div(left, right, quo, out, scratch);
+}
+
+fregister uinteger_rem(rregister left, rregister right, wregister& out)
+{
+    return uinteger_rem(left, right, out, nullptr);
 }
 
 template <asm_bit_op op>
@@ -730,6 +1510,38 @@ void sinteger_tstr(const rregister& in, std::string& str, index_t base, const ch
     uinteger_tstr(in, str, base, digits, prefix);
 }
 
+index_t sinteger_fchars(wregister& out, const char* str, index_t size, index_t base, const char* digits, fregister& flags)
+{
+    const bool negative = ((size != 0) && (str[0] == '-'));
+    const index_t count = uinteger_fchars(out, str + negative, size - negative, base, digits, flags);
+    if (count == 0)
+    {
+        return 0;
+    }
+    out.sign = negative;
+    flags = snorm(out, flags);
+    // Magnitude with msb fits only as the smallest negative value, snorm makes it negative in any case.
+    if (!negative && (out.sign != 0))
+    {
+        flags.set(fregister::overflow);
+    }
+    return count + negative;
+}
+
+index_t sinteger_tchars(const rregister& in, char* first, index_t capacity, index_t base, const char* digits)
+{
+    if (!in.sign)
+    {
+        return uinteger_tchars(in, first, capacity, base, digits);
+    }
+    if (capacity == 0)
+    {
+        return uinteger_tchars(in, first, 0, base, digits) + 1;
+    }
+    first[0] = '-';
+    return uinteger_tchars(in, first + 1, capacity - 1, base, digits) + 1;
+}
+
 fregister sinteger_fbasic(wregister& out, signed long long basic)
 {
     // Cast to unsigned, and obtain info about sign.
@@ -869,16 +1681,42 @@ fregister sinteger_sub(rregister left, rregister right, wregister& out)
     }
 }
 
-fregister sinteger_mul(rregister left, rregister right, wregister& out)
+fregister sinteger_mul(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     out.sign = (left.sign != right.sign);
-    fregister flags = uinteger_mul(left, right, out);
+    fregister flags = uinteger_mul(left, right, out, scratch);
     return snorm(out, flags);
 }
 
+fregister sinteger_mul(rregister left, rregister right, wregister& out)
+{
+    return sinteger_mul(left, right, out, nullptr);
+}
+
+fregister sinteger_div(rregister left, rregister right, wregister& quo, wregister& rem, word_t* scratch)
+{
+    fregister flags = uinteger_div(left, right, quo, rem, scratch);
+    quo.sign = (left.sign != right.sign);
+    rem.sign = left.sign;
+    if (quo.words != nullptr)
+    {
+        flags |= snorm(quo, flags);
+    }
+    if (rem.words != nullptr)
+    {
+        flags |= snorm(rem, flags);
+    }
+    return flags;
+}
+
 fregister sinteger_div(rregister left, rregister right, wregister& quo, wregister& rem)
 {
-    fregister flags = uinteger_div(left, right, quo, rem);
+    return sinteger_div(left, right, quo, rem, nullptr);
+}
+
+fregister sinteger_div_inv(rregister left, rregister right, rregister inverse, wregister& quo, wregister& rem, word_t* scratch)
+{
+    fregister flags = uinteger_div_inv(left, right, inverse, quo, rem, scratch);
     quo.sign = (left.sign != right.sign);
     rem.sign = left.sign;
     if (quo.words != nullptr)
@@ -892,28 +1730,42 @@ fregister sinteger_div(rregister left, rregister right, wregister& quo, wregiste
     return flags;
 }
 
-fregister sinteger_quo(rregister left, rregister right, wregister& out)
+fregister sinteger_quo(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     wregister rem{nullptr, 0, 0, false};
-    return sinteger_div(left, right, out, rem);
+    return sinteger_div(left, right, out, rem, scratch);
 }
 
-fregister sinteger_rem(rregister left, rregister right, wregister& out)
+fregister sinteger_quo(rregister left, rregister right, wregister& out)
+{
+    return sinteger_quo(left, right, out, nullptr);
+}
+
+fregister sinteger_rem(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     wregister quo{nullptr, 0, 0, false};
-    return sinteger_div(left, right, quo, out);
+    return sinteger_div(left, right, quo, out, scratch);
+}
+
+fregister sinteger_rem(rregister left, rregister right, wregister& out)
+{
+    return sinteger_rem(left, right, out, nullptr);
 }
 
 template <asm_bit_op op>
-fregister sinteger_bit(rregister left, rregister right, wregister& out)
+fregister sinteger_bit(rregister left, rregister right, wregister& out, word_t* scratch)
 {
     fregister flags;
+    // Two's complement of negative operands, left takes the head of scratch, right takes the tail.
     array<word_t> left_words = array_null<word_t>();
     array<word_t> right_words = array_null<word_t>();
     if (left.sign)
     {
-        left_words = array_alloc<word_t>(out.capacity);
-        wregister wuleft{left_words.get(), out.capacity, left.size, left.sign};
+        if (scratch == nullptr)
+        {
+            left_words = array_alloc<word_t>(out.capacity);
+        }
+        wregister wuleft{(scratch != nullptr) ? scratch : left_words.get(), out.capacity, left.size, left.sign};
         sinteger_tou(left, wuleft);
         left.words = wuleft.words;
         left.size = wuleft.size;
@@ -921,8 +1773,11 @@ fregister sinteger_bit(rregister left, rregister right, wregister& out)
     }
     if (right.sign)
     {
-        right_words = array_alloc<word_t>(out.capacity);
-        wregister wuright{right_words.get(), out.capacity, right.size, right.sign};
+        if (scratch == nullptr)
+        {
+            right_words = array_alloc<word_t>(out.capacity);
+        }
+        wregister wuright{(scratch != nullptr) ? scratch + out.capacity : right_words.get(), out.capacity, right.size, right.sign};
         sinteger_tou(right, wuright);
         right.words = wuright.words;
         right.size = wuright.size;
@@ -933,29 +1788,47 @@ fregister sinteger_bit(rregister left, rregister right, wregister& out)
     return flags;
 }
 
+fregister sinteger_and(rregister left, rregister right, wregister& out, word_t* scratch)
+{
+    return sinteger_bit<asm_and>(left, right, out, scratch);
+}
+
 fregister sinteger_and(rregister left, rregister right, wregister& out)
 {
-    return sinteger_bit<asm_and>(left, right, out);
+    return sinteger_and(left, right, out, nullptr);
+}
+
+fregister sinteger_or(rregister left, rregister right, wregister& out, word_t* scratch)
+{
+    return sinteger_bit<asm_or>(left, right, out, scratch);
 }
 
 fregister sinteger_or(rregister left, rregister right, wregister& out)
 {
-    return sinteger_bit<asm_or>(left, right, out);
+    return sinteger_or(left, right, out, nullptr);
+}
+
+fregister sinteger_xor(rregister left, rregister right, wregister& out, word_t* scratch)
+{
+    return sinteger_bit<asm_xor>(left, right, out, scratch);
 }
 
 fregister sinteger_xor(rregister left, rregister right, wregister& out)
 {
-    return sinteger_bit<asm_xor>(left, right, out);
+    return sinteger_xor(left, right, out, nullptr);
 }
 
-fregister sinteger_not(rregister in, wregister& out)
+fregister sinteger_not(rregister in, wregister& out, word_t* scratch)
 {
     fregister flags;
     array<word_t> in_words = array_null<word_t>();
     if (in.sign)
     {
-        in_words = array_alloc<word_t>(out.capacity);
-        wregister wuin{in_words.get(), out.capacity, in.size, in.sign};
+        if (scratch == nullptr)
+        {
+            in_words = array_alloc<word_t>(out.capacity);
+        }
+        wregister wuin{(scratch != nullptr) ? scratch : in_words.get(), out.capacity, in.size, in.sign};
         sinteger_tou(in, wuin);
         in.words = wuin.words;
         in.size = wuin.size;
@@ -965,6 +1838,11 @@ fregister sinteger_not(rregister in, wregister& out)
     return snorm(out, flags);
 }
 
+fregister sinteger_not(rregister in, wregister& out)
+{
+    return sinteger_not(in, out, nullptr);
+}
+
 fregister sinteger_rsh(rregister in, index_t shift, wregister& out)
 {
     fregister flags;
@@ -16,6 +16,10 @@ namespace library
 // Estimate number of word_t required to contain value represented by string of length str_size with given base.
 static inline index_t est_fstr(index_t str_size, index_t base);
 
+// Estimate number of word_t required to contain value of the digits at the beginning of str, as many as fchars takes.
+// Leading '-' is skipped.
+static inline index_t est_fchars(const char* str, index_t size, index_t base, const char* digits);
+
 // Estimate size of string required to contain the value represented by in_size word_t values.
 static inline index_t est_tstr(index_t in_size, index_t base);
 
@@ -35,6 +39,18 @@ static inline index_t est_rem(index_t left_size, index_t right_size);
 
 static inline index_t est_bit(index_t left_size, index_t right_size);
 
+// Estimate number of scratch word_t required by division with reciprocal.
+static inline index_t est_div_inv(index_t left_size, index_t right_size);
+
+// Estimate number of scratch word_t required by multiplication.
+static inline index_t est_mul_scratch(index_t left_size, index_t right_size);
+
+// Estimate number of scratch word_t required by division, quotient and remainder.
+static inline index_t est_div_scratch(index_t left_size, index_t right_size);
+
+// Estimate number of scratch word_t required by signed bitwise operations, out_capacity is capacity of the result.
+static inline index_t est_bit_scratch(index_t out_capacity);
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Unsigned declarations
 // Never change sign on unsigned values.
@@ -45,6 +61,25 @@ ap_linkage fregister uinteger_fstr(wregister& out, const char* str, index_t size
 // Convert to string.
 ap_linkage void uinteger_tstr(const rregister& in, std::string& str, index_t base, const char* digits, bool prefix = true);
 
+// Split for incremental conversion to string, in = quo * base^digits + rem, where rem is about half of in.
+// Return: digits, number of digits rem takes in the string, including leading zeros.
+// Preconditions:
+// in.size >= 2.
+// quo.capacity >= in.size, rem.capacity >= in.size.
+ap_linkage index_t uinteger_tstr_split(const rregister& in, index_t base, wregister& quo, wregister& rem);
+
+// Convert from leading digits of str[0, size), there is no sign and no prefix.
+// Return: number of characters converted, 0 if str does not start with a digit.
+ap_linkage index_t uinteger_fchars(wregister& out, const char* str, index_t size, index_t base, const char* digits, fregister& flags);
+
+// Same as uinteger_fchars, but digits are appended to the value in out, flags are accumulated.
+ap_linkage index_t uinteger_fchars_append(wregister& out, const char* str, index_t size, index_t base, const char* digits, fregister& flags);
+
+// Convert to characters first[0, capacity), there is no prefix. Nothing is allocated for values shorter than
+// AP_TSTR_THRESHOLD words and power of two bases.
+// Return: number of characters required, first[0, capacity) is unspecified if it is greater than capacity.
+ap_linkage index_t uinteger_tchars(const rregister& in, char* first, index_t capacity, index_t base, const char* digits);
+
 // Convert from basic unsigned.
 ap_linkage fregister uinteger_fbasic(wregister& out, unsigned long long basic);
 
@@ -69,9 +104,15 @@ ap_linkage fregister uinteger_sub(rregister left, rregister right, wregister& ou
 // Multiplication.
 ap_linkage fregister uinteger_mul(rregister left, rregister right, wregister& out);
 
-// Division.
+// Division, quotient and remainder are computed in one pass. Result with capacity 0 is kept in temporary storage.
 ap_linkage fregister uinteger_div(rregister left, rregister right, wregister& quo, wregister& rem);
 
+// Division with reciprocal of right, see asm_invert. Quotient or remainder is not computed, if its capacity is 0.
+// Preconditions:
+// right.size >= 2.
+// scratch holds at least est_div_inv(left.size, right.size) words.
+ap_linkage fregister uinteger_div_inv(rregister left, rregister right, rregister inverse, wregister& quo, wregister& rem, word_t* scratch);
+
 // Quotient.
 ap_linkage fregister uinteger_quo(rregister left, rregister right, wregister& out);
 
@@ -96,6 +137,15 @@ ap_linkage fregister uinteger_rsh(rregister in, index_t shift, wregister& out);
 // Left bit shift.
 ap_linkage fregister uinteger_lsh(rregister in, index_t shift, wregister& out);
 
+// Same operations with caller scratch, nothing is allocated unless scratch is null.
+// Preconditions:
+// scratch is null or holds at least est_mul_scratch(left.size, right.size) words for multiplication,
+// est_div_scratch(left.size, right.size) words for division, quotient and remainder.
+ap_linkage fregister uinteger_mul(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister uinteger_div(rregister left, rregister right, wregister& quo, wregister& rem, word_t* scratch);
+ap_linkage fregister uinteger_quo(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister uinteger_rem(rregister left, rregister right, wregister& out, word_t* scratch);
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Signed declarations
 // Properly set sign on signed values.
@@ -106,6 +156,15 @@ ap_linkage fregister sinteger_fstr(wregister& out, const char* str, index_t size
 // Convert to string.
 ap_linkage void sinteger_tstr(const rregister& in, std::string& str, index_t base, const char* digits, bool prefix = true);
 
+// Convert from leading characters of str[0, size), "-" is the only accepted sign and there is no prefix. Values out of
+// range set overflow.
+// Return: number of characters converted, 0 if str does not start with a digit.
+ap_linkage index_t sinteger_fchars(wregister& out, const char* str, index_t size, index_t base, const char* digits, fregister& flags);
+
+// Convert to characters first[0, capacity), "-" is the only sign and there is no prefix.
+// Return: number of characters required, first[0, capacity) is unspecified if it is greater than capacity.
+ap_linkage index_t sinteger_tchars(const rregister& in, char* first, index_t capacity, index_t base, const char* digits);
+
 // Convert from basic signed.
 ap_linkage fregister sinteger_fbasic(wregister& out, signed long long basic);
 
@@ -133,6 +192,9 @@ ap_linkage fregister sinteger_mul(rregister left, rregister right, wregister& ou
 // Division.
 ap_linkage fregister sinteger_div(rregister left, rregister right, wregister& quo, wregister& rem);
 
+// Division with reciprocal of right magnitude, see uinteger_div_inv.
+ap_linkage fregister sinteger_div_inv(rregister left, rregister right, rregister inverse, wregister& quo, wregister& rem, word_t* scratch);
+
 // Quotient.
 ap_linkage fregister sinteger_quo(rregister left, rregister right, wregister& out);
 
@@ -157,6 +219,20 @@ ap_linkage fregister sinteger_rsh(rregister in, index_t shift, wregister& out);
 // Left bit shift.
 ap_linkage fregister sinteger_lsh(rregister in, index_t shift, wregister& out);
 
+// Same operations with caller scratch, nothing is allocated unless scratch is null.
+// Preconditions:
+// scratch is null or holds at least est_mul_scratch(left.size, right.size) words for multiplication,
+// est_div_scratch(left.size, right.size) words for division, quotient and remainder,
+// est_bit_scratch(out.capacity) words for bitwise operations.
+ap_linkage fregister sinteger_mul(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister sinteger_div(rregister left, rregister right, wregister& quo, wregister& rem, word_t* scratch);
+ap_linkage fregister sinteger_quo(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister sinteger_rem(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister sinteger_and(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister sinteger_or(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister sinteger_xor(rregister left, rregister right, wregister& out, word_t* scratch);
+ap_linkage fregister sinteger_not(rregister in, wregister& out, word_t* scratch);
+
 } // namespace library
 } // namespace ap
 
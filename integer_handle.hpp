@@ -2,6 +2,8 @@
 #define DEOHAYER_AP_INT_HANDLE_HPP
 
 #include "asm.hpp"
+#include <memory>
+#include <type_traits>
 
 namespace ap
 {
@@ -10,29 +12,270 @@ namespace library
 
 #define AP_ALIGN(val, a) ((((val) + a - 1) / a) * a)
 
-template <index_t _Bitwidth>
+// Bitwidth 0 declares dynamic integer, it is the widest one.
+static constexpr index_t declared_bitwidth(index_t bitwidth)
+{
+    return (bitwidth != 0) ? bitwidth : (index_t{1} << (index_traits::bits / 2)) - 1;
+}
+
+// Storage of integer words, either inline or allocated with _Allocator.
+template <index_t _Wordwidth, bool _Inline, typename _Allocator>
+class handle_storage;
+
+// Words are held inside of the object. Moving the storage does not move the words, handle copies them itself.
+template <index_t _Wordwidth, typename _Allocator>
+class handle_storage<_Wordwidth, true, _Allocator>
+{
+    word_t words[_Wordwidth];
+
+public:
+    handle_storage() {}
+
+    // Inline words are not allocated.
+    explicit handle_storage(const _Allocator& alloc)
+    {
+        AP_UNUSED(alloc);
+    }
+
+    handle_storage(handle_storage&& other)
+    {
+        AP_UNUSED(other);
+    }
+
+    template <index_t _WordwidthO, bool _InlineO, typename _AllocatorO>
+    handle_storage(handle_storage<_WordwidthO, _InlineO, _AllocatorO>&& other)
+    {
+        AP_UNUSED(other);
+    }
+
+    handle_storage& operator=(handle_storage&& other)
+    {
+        AP_UNUSED(other);
+        return *this;
+    }
+
+    template <index_t _WordwidthO, bool _InlineO, typename _AllocatorO>
+    handle_storage& operator=(handle_storage<_WordwidthO, _InlineO, _AllocatorO>&& other)
+    {
+        AP_UNUSED(other);
+        return *this;
+    }
+
+    word_t* get()
+    {
+        return this->words;
+    }
+
+    index_t get_capacity() const
+    {
+        return _Wordwidth;
+    }
+
+    _Allocator get_allocator() const
+    {
+        return _Allocator();
+    }
+
+    // Inline words never change capacity.
+    void resize(index_t count)
+    {
+        AP_UNUSED(count);
+    }
+};
+
+// Words are allocated with _Allocator, it is kept as a base, so stateless allocators take no space. Moving the storage
+// steals the words of other storage with the same allocator type. Move assignment steals them only if allocators are equal,
+// otherwise own words are kept and handle copies the words itself. _Wordwidth is the initial capacity, nothing is allocated
+// for 0.
+template <index_t _Wordwidth, typename _Allocator>
+class handle_storage<_Wordwidth, false, _Allocator> : private _Allocator
+{
+    static_assert(std::is_same<typename _Allocator::value_type, word_t>::value, "AP: allocator value_type must be word_t");
+
+    template <index_t _WordwidthO, bool _InlineO, typename _AllocatorO>
+    friend class handle_storage;
+
+    using traits = std::allocator_traits<_Allocator>;
+
+    word_t* words;
+    index_t capacity;
+
+    _Allocator& allocator()
+    {
+        return *this;
+    }
+
+    const _Allocator& allocator() const
+    {
+        return *this;
+    }
+
+    void release()
+    {
+        if (this->words != nullptr)
+        {
+            traits::deallocate(this->allocator(), this->words, this->capacity);
+        }
+        this->words = nullptr;
+        this->capacity = 0;
+    }
+
+    template <index_t _WordwidthO>
+    void steal(handle_storage<_WordwidthO, false, _Allocator>& other)
+    {
+        this->words = other.words;
+        this->capacity = other.capacity;
+        other.words = nullptr;
+        other.capacity = 0;
+    }
+
+    // Default allocator resizes in place, if it can.
+    static word_t* reallocate(array_allocator<word_t>& alloc, word_t* words, index_t size, index_t count)
+    {
+        return alloc.reallocate(words, size, count);
+    }
+
+    template <typename _AllocatorO>
+    static word_t* reallocate(_AllocatorO& alloc, word_t* words, index_t size, index_t count)
+    {
+        word_t* result = std::allocator_traits<_AllocatorO>::allocate(alloc, count);
+        if (words != nullptr)
+        {
+            std::memcpy(result, words, AP_MIN(size, count) * word_traits::bytes);
+            std::allocator_traits<_AllocatorO>::deallocate(alloc, words, size);
+        }
+        return result;
+    }
+
+public:
+    handle_storage() : handle_storage(_Allocator()) {}
+
+    explicit handle_storage(const _Allocator& alloc)
+        : _Allocator(alloc),
+          words((_Wordwidth != 0) ? traits::allocate(this->allocator(), _Wordwidth) : nullptr),
+          capacity(_Wordwidth)
+    {
+    }
+
+    handle_storage(handle_storage&& other)
+        : _Allocator(std::move(other.allocator())),
+          words(nullptr),
+          capacity(0)
+    {
+        this->steal(other);
+    }
+
+    template <index_t _WordwidthO>
+    handle_storage(handle_storage<_WordwidthO, false, _Allocator>&& other)
+        : _Allocator(std::move(other.allocator())),
+          words(nullptr),
+          capacity(0)
+    {
+        this->steal(other);
+    }
+
+    template <index_t _WordwidthO, bool _InlineO, typename _AllocatorO>
+    handle_storage(handle_storage<_WordwidthO, _InlineO, _AllocatorO>&& other) : handle_storage()
+    {
+        AP_UNUSED(other);
+    }
+
+    ~handle_storage()
+    {
+        this->release();
+    }
+
+    handle_storage& operator=(handle_storage&& other)
+    {
+        return this->operator=<_Wordwidth>(std::move(other));
+    }
+
+    template <index_t _WordwidthO>
+    handle_storage& operator=(handle_storage<_WordwidthO, false, _Allocator>&& other)
+    {
+        if (this->allocator() == other.allocator())
+        {
+            this->release();
+            this->steal(other);
+        }
+        return *this;
+    }
+
+    template <index_t _WordwidthO, bool _InlineO, typename _AllocatorO>
+    handle_storage& operator=(handle_storage<_WordwidthO, _InlineO, _AllocatorO>&& other)
+    {
+        AP_UNUSED(other);
+        return *this;
+    }
+
+    word_t* get()
+    {
+        return this->words;
+    }
+
+    index_t get_capacity() const
+    {
+        return this->capacity;
+    }
+
+    _Allocator get_allocator() const
+    {
+        return this->allocator();
+    }
+
+    void resize(index_t count)
+    {
+        this->words = reallocate(this->allocator(), this->words, this->capacity, count);
+        this->capacity = count;
+    }
+};
+
+template <index_t _Bitwidth, typename _Allocator>
 class integer_handle
 {
-    template <index_t _BitwidthO>
+    template <index_t _BitwidthO, typename _AllocatorO>
     friend class integer_handle;
 
 public:
+    // Values of dynamic integers (bitwidth 0) wrap at wordwidth as well, but words are allocated on demand, capacity of reg
+    // is the allocated size. It is kept greater than the size of the value, until it reaches wordwidth, so the most
+    // significant bit of capacity is set only by values which wrap.
     enum : index_t
     {
-        bitwidth = AP_ALIGN((_Bitwidth != 0) ? _Bitwidth : (index_t{1} << (index_traits::bits / 2)) - 1, word_traits::bits),
-        wordwidth = bitwidth / word_traits::bits
+        bitwidth = AP_ALIGN(declared_bitwidth(_Bitwidth), word_traits::bits),
+        wordwidth = bitwidth / word_traits::bits,
+        is_inline = (bitwidth <= AP_INLINE_BITWIDTH),
+        is_dynamic = (_Bitwidth == 0)
     };
 
 private:
-    array<word_t> words;
+    handle_storage<(is_dynamic ? 0 : wordwidth), is_inline, _Allocator> words;
     wregister reg;
 
+    // Point reg to own words. Words which were not taken over during move are copied.
+    void rebind()
+    {
+        if (this->reg.words != this->words.get())
+        {
+            this->reg.size = AP_MIN(this->reg.size, this->wordwidth);
+            if (this->is_dynamic && (this->words.get_capacity() <= this->reg.size))
+            {
+                this->words.resize(AP_MIN(this->reg.size + 1, this->wordwidth));
+            }
+            wregister out{this->words.get(), this->words.get_capacity(), 0, this->reg.sign};
+            asm_cp(rregister(this->reg), out);
+            this->reg = out;
+        }
+    }
+
     void normalize()
     {
-        if (this->get_capacity() != this->wordwidth)
+        this->rebind();
+        const index_t capacity = (this->is_dynamic ? AP_MIN(this->get_capacity(), this->wordwidth) : this->wordwidth);
+        if (this->get_capacity() != capacity)
         {
-            this->reg.capacity = this->wordwidth;
-            array_realloc(this->words, this->get_capacity());
+            this->reg.capacity = capacity;
+            this->words.resize(this->get_capacity());
             this->reg.words = this->words.get();
             this->reg.size = AP_MIN(this->reg.capacity, this->reg.size);
         }
@@ -41,17 +284,24 @@ private:
         {
             this->reg.sign = 0;
         }
+        this->reserve(this->reg.size + 1);
     }
 
 public:
     integer_handle()
-        : words(array_alloc<word_t>(wordwidth)),
-          reg(words.get(), wordwidth, 0, false)
+        : words(),
+          reg(words.get(), words.get_capacity(), 0, false)
     {
     }
 
-    template <index_t _BitwidthO>
-    integer_handle(integer_handle<_BitwidthO>&& other)
+    explicit integer_handle(const _Allocator& alloc)
+        : words(alloc),
+          reg(words.get(), words.get_capacity(), 0, false)
+    {
+    }
+
+    template <index_t _BitwidthO, typename _AllocatorO>
+    integer_handle(integer_handle<_BitwidthO, _AllocatorO>&& other)
         : words(std::move(other.words)),
           reg(other.reg)
     {
@@ -62,12 +312,14 @@ public:
         : words(std::move(other.words)),
           reg(other.reg)
     {
+        this->rebind();
     }
 
-    template <index_t _BitwidthO>
-    integer_handle(const integer_handle<_BitwidthO>& other) : integer_handle()
+    template <index_t _BitwidthO, typename _AllocatorO>
+    integer_handle(const integer_handle<_BitwidthO, _AllocatorO>& other) : integer_handle()
     {
         rregister other_reg = other.get_rregister();
+        this->reserve(other_reg.size + 1);
         other_reg.size = AP_MIN(other_reg.size, this->get_capacity());
         asm_cp(other_reg, this->reg);
         this->set_sign(other_reg.sign);
@@ -76,12 +328,13 @@ public:
 
     integer_handle(const integer_handle& other) : integer_handle()
     {
+        this->reserve(other.get_size() + 1);
         asm_cp(other.get_rregister(), this->reg);
         this->set_sign(other.reg.sign);
     }
 
-    template <index_t _BitwidthO>
-    integer_handle& operator=(integer_handle<_BitwidthO>&& other)
+    template <index_t _BitwidthO, typename _AllocatorO>
+    integer_handle& operator=(integer_handle<_BitwidthO, _AllocatorO>&& other)
     {
         this->words = std::move(other.words);
         this->reg = other.reg;
@@ -95,14 +348,16 @@ public:
         {
             this->words = std::move(other.words);
             this->reg = other.reg;
+            this->rebind();
         }
         return *this;
     }
 
-    template <index_t _BitwidthO>
-    integer_handle& operator=(const integer_handle<_BitwidthO>& other)
+    template <index_t _BitwidthO, typename _AllocatorO>
+    integer_handle& operator=(const integer_handle<_BitwidthO, _AllocatorO>& other)
     {
         rregister other_reg = other.get_rregister();
+        this->reserve(other_reg.size + 1);
         other_reg.size = AP_MIN(other_reg.size, this->get_capacity());
         asm_cp(other_reg, this->reg);
         this->set_sign(other_reg.sign);
@@ -114,12 +369,18 @@ public:
     {
         if (this != &other)
         {
+            this->reserve(other.get_size() + 1);
             asm_cp(other.get_rregister(), this->reg);
             this->set_sign(other.get_sign());
         }
         return *this;
     }
 
+    _Allocator get_allocator() const
+    {
+        return this->words.get_allocator();
+    }
+
     rregister get_rregister() const
     {
         return rregister(this->reg);
@@ -154,6 +415,33 @@ public:
     {
         return this->reg.capacity;
     }
+
+    // Make capacity at least count words, but not more than wordwidth, value is kept. Dynamic integers grow at least twice,
+    // integers of fixed width always have wordwidth words. Registers taken before are invalidated.
+    void reserve(index_t count)
+    {
+        if (this->is_dynamic && (count > this->reg.capacity) && (this->reg.capacity < this->wordwidth))
+        {
+            count = AP_MIN(AP_MAX(count, 2 * this->reg.capacity), index_t(this->wordwidth));
+            this->words.resize(count);
+            this->reg.words = this->words.get();
+            this->reg.capacity = count;
+        }
+    }
+
+    // Unsigned value wrapped below zero at capacity less than wordwidth, while the words it was computed from are shorter.
+    // Make it wrapped at wordwidth, words above capacity are all ones for such values.
+    void extend_wrapped()
+    {
+        if (this->is_dynamic && (this->reg.capacity < this->wordwidth))
+        {
+            const index_t capacity = this->reg.capacity;
+            this->reserve(this->wordwidth);
+            wregister high{this->reg.words + capacity, this->reg.capacity - capacity, 0, false};
+            asm_fill(high, ~word_t{0});
+            this->reg.size = this->reg.capacity;
+        }
+    }
 };
 
 #undef AP_ALIGN